@@ -5,8 +5,12 @@
 #ifndef DCK_H
 #define DCK_H
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "mem.h"
 
 
 #define dck_stretchy_t(data_type, size_type) struct { data_type *data; size_type count, capacity; }
@@ -20,7 +24,8 @@ do {
     if ((dck).count == (dck).capacity) {                                                \
         (dck).capacity = (dck).capacity ? (dck).capacity * 2                            \
                                           : 4096 / sizeof(*((dck).data));               \
-        (dck).data = realloc((dck).data, sizeof(*((dck).data)) * (dck).capacity);       \
+        (dck).data = mem_realloc(mem_tag(), (dck).data,                                 \
+                                 sizeof(*((dck).data)) * (dck).capacity);               \
         if (!(dck).data) {                                                              \
             fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__); \
             exit(666);                                                                  \
@@ -40,7 +45,8 @@ do {
         while ((dck).count + (amount) > (dck).capacity) {                               \
             (dck).capacity *= 2;                                                        \
         }                                                                               \
-        (dck).data = realloc((dck).data, sizeof(*((dck).data)) * (dck).capacity);       \
+        (dck).data = mem_realloc(mem_tag(), (dck).data,                                 \
+                                 sizeof(*((dck).data)) * (dck).capacity);               \
         if (!(dck).data) {                                                              \
             fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__); \
             exit(666);                                                                  \
@@ -48,5 +54,493 @@ do {
     }                                                                                   \
 } while (0)
 
+/* argument must be an 'lvalue' */
+#define dck_stretchy_free(dck)                                                          \
+do {                                                                                    \
+    mem_free((dck).data);                                                               \
+    (dck).data     = NULL;                                                              \
+    (dck).count    = 0;                                                                 \
+    (dck).capacity = 0;                                                                 \
+} while (0)
+
+
+/* Segmented stretchy buffer.
+ *
+ * Elements live in segments that double in size, segment k holds
+ * DCK_SEGMENT_FIRST << k of them. Growing allocates the next segment and never
+ * moves the ones before it, so element addresses are stable, peak memory is
+ * the segments themselves and counts are 64 bit. `next` and `end` bound the
+ * free part of the current segment, a push is a compare and a store.
+ */
+
+#define DCK_SEGMENT_SHIFT 10
+#define DCK_SEGMENT_FIRST ((uint64_t)1 << DCK_SEGMENT_SHIFT)
+#define DCK_SEGMENT_MAX   (64 - DCK_SEGMENT_SHIFT)
+
+#define dck_segmented_t(data_type) \
+    struct { data_type *segments[DCK_SEGMENT_MAX]; data_type *next, *end; uint64_t count; }
+
+/* Element `index` as an 'lvalue', `index` is evaluated twice. */
+#define dck_segmented_at(dck, index) \
+    ((dck).segments[dck__segment(index)][dck__segment_offset(index)])
+
+/* argument must be an 'lvalue', except for `...` */
+#define dck_segmented_push(dck, ...)                                                    \
+do {                                                                                    \
+    if ((dck).next == (dck).end) {                                                      \
+        dck__segmented_enter(dck);                                                      \
+    }                                                                                   \
+    *(dck).next++ = __VA_ARGS__;                                                        \
+    (dck).count++;                                                                      \
+} while (0)
+
+/* Allocates the segments for `amount` more elements up front.
+ * argument must be an 'lvalue', except for `amount`
+ */
+#define dck_segmented_reserve(dck, amount)                                              \
+do {                                                                                    \
+    if ((amount) > 0) {                                                                 \
+        unsigned dck__k    = dck__segment((dck).count);                                 \
+        unsigned dck__last = dck__segment((dck).count + (amount) - 1);                  \
+        for (; dck__k <= dck__last; ++dck__k) {                                         \
+            dck__segmented_alloc(dck, dck__k);                                          \
+        }                                                                               \
+    }                                                                                   \
+} while (0)
+
+/* Copies `amount` elements from `first` on into the contiguous `dst`.
+ * argument must be an 'lvalue', except for `dst`, `first` and `amount`
+ */
+#define dck_segmented_gather(dck, dst, first, amount)                                   \
+do {                                                                                    \
+    char    *dck__dst  = (char *)(dst);                                                 \
+    uint64_t dck__at   = (first);                                                       \
+    uint64_t dck__left = (amount);                                                      \
+    while (dck__left) {                                                                 \
+        unsigned dck__k      = dck__segment(dck__at);                                   \
+        uint64_t dck__offset = dck__segment_offset(dck__at);                            \
+        uint64_t dck__run    = (DCK_SEGMENT_FIRST << dck__k) - dck__offset;             \
+        if (dck__run > dck__left) {                                                     \
+            dck__run = dck__left;                                                       \
+        }                                                                               \
+        memcpy(dck__dst, (dck).segments[dck__k] + dck__offset,                          \
+               dck__run * sizeof(*(dck).next));                                         \
+        dck__dst  += dck__run * sizeof(*(dck).next);                                    \
+        dck__at   += dck__run;                                                          \
+        dck__left -= dck__run;                                                          \
+    }                                                                                   \
+} while (0)
+
+/* Keeps the segments. argument must be an 'lvalue' */
+#define dck_segmented_clear(dck)                                                        \
+do {                                                                                    \
+    (dck).next  = NULL;                                                                 \
+    (dck).end   = NULL;                                                                 \
+    (dck).count = 0;                                                                    \
+} while (0)
+
+/* argument must be an 'lvalue' */
+#define dck_segmented_free(dck)                                                         \
+do {                                                                                    \
+    for (unsigned dck__k = 0; dck__k < DCK_SEGMENT_MAX; ++dck__k) {                     \
+        mem_free((dck).segments[dck__k]);                                               \
+        (dck).segments[dck__k] = NULL;                                                  \
+    }                                                                                   \
+    dck_segmented_clear(dck);                                                           \
+} while (0)
+
+static inline unsigned
+dck__log2(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - (unsigned)__builtin_clzll(value);
+#else
+    unsigned log = 0;
+    while (value >>= 1) {
+        ++log;
+    }
+    return log;
+#endif
+}
+
+static inline unsigned
+dck__segment(uint64_t index)
+{
+    return dck__log2(index + DCK_SEGMENT_FIRST) - DCK_SEGMENT_SHIFT;
+}
+
+static inline uint64_t
+dck__segment_offset(uint64_t index)
+{
+    uint64_t biased = index + DCK_SEGMENT_FIRST;
+    return biased - ((uint64_t)1 << dck__log2(biased));
+}
+
+#define dck__segmented_alloc(dck, k)                                                    \
+do {                                                                                    \
+    if (!(dck).segments[k]) {                                                           \
+        (dck).segments[k] = mem_alloc(mem_tag(), sizeof(*(dck).next)                    \
+                                                 * (DCK_SEGMENT_FIRST << (k)));         \
+        if (!(dck).segments[k]) {                                                       \
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__); \
+            exit(666);                                                                  \
+        }                                                                               \
+    }                                                                                   \
+} while (0)
+
+/* Points `next` and `end` at the segment element `count` goes in. */
+#define dck__segmented_enter(dck)                                                       \
+do {                                                                                    \
+    unsigned dck__k = dck__segment((dck).count);                                        \
+    dck__segmented_alloc(dck, dck__k);                                                  \
+    (dck).next = (dck).segments[dck__k] + dck__segment_offset((dck).count);             \
+    (dck).end  = (dck).segments[dck__k] + (DCK_SEGMENT_FIRST << dck__k);                \
+} while (0)
+
+
+/* Open addressing hash map, Robin Hood probing with backward shift deletion.
+ *
+ * Keys and values live in two arrays indexed by slot, `probes` holds each
+ * slot's distance from its home slot plus one, 0 for a free slot. Keys are
+ * hashed and compared bytewise, they have to be POD without padding (or with
+ * the padding zeroed). Slot indices stay valid until the next put or remove.
+ *
+ * The capacity is a power of two and the map grows at 7/8 load, or earlier if
+ * a probe distance no longer fits a byte. Clearing keeps the memory.
+ */
+
+#define dck_map_t(key_type, value_type, size_type) \
+    struct { key_type *keys; value_type *values; unsigned char *probes; size_type count, capacity; }
+
+#define DCK_MAP_NONE ((size_t)-1)
+
+/* Iterates the occupied slots. */
+#define dck_map_for(map, index) \
+    for (size_t index = 0; index < (size_t)(map).capacity; ++index) if (!(map).probes[index]) {} else
+
+/* Slot of `key`, DCK_MAP_NONE if it's missing. Key must be an 'lvalue'. */
+#define dck_map_find(map, key) \
+    (dck__map_check_key(map, key), dck__map_find(dck__map_table(map), sizeof(*(map).keys), &(key)))
+
+/* Pointer to the value of `key`, NULL if it's missing. Key must be an 'lvalue'. */
+#define dck_map_get(map, key) \
+    dck__map_value(dck__map_table(map), sizeof(*(map).values), dck_map_find(map, key))
+
+/* Sets `slot` to the slot of `key`, adding the key if it's missing, and
+ * `added` to whether it did. An added key's value is left for the caller.
+ * Arguments must be 'lvalues'
+ */
+#define dck_map_insert(map, key, slot, added)                                           \
+do {                                                                                    \
+    dck__map_check_key(map, key);                                                       \
+    dck_map_reserve(map, 1);                                                            \
+    while (((slot) = dck__map_insert(dck__map_table(map), sizeof(*(map).keys),          \
+                                     sizeof(*(map).values), &(key), &(added)))          \
+           == DCK_MAP_NONE) {                                                           \
+        dck__map_resize(map, (size_t)(map).capacity * 2);                               \
+    }                                                                                   \
+    (map).count += (added);                                                             \
+} while (0)
+
+/* Adds `key` or overwrites its value. Arguments must be 'lvalues', except for `...` */
+#define dck_map_put(map, key, ...)                                                      \
+do {                                                                                    \
+    size_t dck__slot;                                                                   \
+    int    dck__added;                                                                  \
+    dck_map_insert(map, key, dck__slot, dck__added);                                    \
+    (map).values[dck__slot] = __VA_ARGS__;                                              \
+} while (0)
+
+/* Removes `key` if it's there. Arguments must be 'lvalues' */
+#define dck_map_remove(map, key)                                                        \
+do {                                                                                    \
+    dck__map_check_key(map, key);                                                       \
+    (map).count -= dck__map_remove(dck__map_table(map), sizeof(*(map).keys),            \
+                                   sizeof(*(map).values), &(key));                      \
+} while (0)
+
+/* Makes room for `amount` more keys. Argument must be an 'lvalue', except for `amount` */
+#define dck_map_reserve(map, amount)                                                    \
+do {                                                                                    \
+    size_t dck__capacity = (map).capacity ? (size_t)(map).capacity : 16;                \
+    while (((size_t)(map).count + (amount)) * 8 > dck__capacity * 7) {                  \
+        dck__capacity *= 2;                                                             \
+    }                                                                                   \
+    if (dck__capacity != (size_t)(map).capacity) {                                      \
+        dck__map_resize(map, dck__capacity);                                            \
+    }                                                                                   \
+} while (0)
+
+/* argument must be an 'lvalue' */
+#define dck_map_clear(map)                                                              \
+do {                                                                                    \
+    if ((map).capacity) {                                                               \
+        memset((map).probes, 0, (size_t)(map).capacity);                                \
+    }                                                                                   \
+    (map).count = 0;                                                                    \
+} while (0)
+
+/* argument must be an 'lvalue' */
+#define dck_map_free(map)                                                               \
+do {                                                                                    \
+    mem_free((map).keys);                                                               \
+    mem_free((map).values);                                                             \
+    mem_free((map).probes);                                                             \
+    (map).keys     = NULL;                                                              \
+    (map).values   = NULL;                                                              \
+    (map).probes   = NULL;                                                              \
+    (map).count    = 0;                                                                 \
+    (map).capacity = 0;                                                                 \
+} while (0)
+
+/* Hash for POD keys, 8 bytes at a time with a multiply-xorshift mix. */
+static inline uint64_t
+dck_hash(const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 31;
+    }
+
+    if (size) {
+        uint64_t word = 0;
+        memcpy(&word, bytes, size);
+
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 31;
+    }
+
+    hash ^= hash >> 32;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 29;
+
+    return hash;
+}
+
+
+/* Type erased tables, the macros above pass the sizes. */
+typedef struct
+{
+    void *keys;
+    void *values;
+    unsigned char *probes;
+    size_t capacity;
+} dck__map_table_t;
+
+#define dck__map_table(map) \
+    ((dck__map_table_t) { (map).keys, (map).values, (map).probes, (size_t)(map).capacity })
+
+#define dck__map_check_key(map, key) \
+    ((void)sizeof(char[sizeof(key) == sizeof(*(map).keys) ? 1 : -1]))
+
+#define dck__map_resize(map, slots)                                                     \
+do {                                                                                    \
+    dck__map_table_t dck__table = dck__map_rehash(dck__map_table(map),                  \
+                                                  sizeof(*(map).keys),                  \
+                                                  sizeof(*(map).values), (slots));      \
+    (map).keys     = dck__table.keys;                                                   \
+    (map).values   = dck__table.values;                                                 \
+    (map).probes   = dck__table.probes;                                                 \
+    (map).capacity = dck__table.capacity;                                               \
+} while (0)
+
+static inline size_t
+dck__map_find(dck__map_table_t table, size_t key_size, const void *key)
+{
+    if (!table.capacity)
+        return DCK_MAP_NONE;
+
+    size_t mask = table.capacity - 1;
+    size_t slot = dck_hash(key, key_size) & mask;
+
+    // a richer resident ends the search, the key would have taken its slot
+    for (unsigned probe = 1; table.probes[slot] >= probe; ++probe, slot = (slot + 1) & mask) {
+        if (table.probes[slot] == probe &&
+            memcmp((char *)table.keys + slot * key_size, key, key_size) == 0) {
+            return slot;
+        }
+    }
+
+    return DCK_MAP_NONE;
+}
+
+static inline void *
+dck__map_value(dck__map_table_t table, size_t value_size, size_t slot)
+{
+    return slot == DCK_MAP_NONE ? NULL : (char *)table.values + slot * value_size;
+}
+
+/* Returns the slot of `key`, making one if it's missing, or DCK_MAP_NONE if a
+ * probe distance would overflow. Needs a free slot.
+ *
+ * Robin Hood keeps every run sorted by home slot, so the new key goes where
+ * the first richer resident is and the rest of the run moves up one slot.
+ */
+static inline size_t
+dck__map_insert(dck__map_table_t table, size_t key_size, size_t value_size, const void *key, int *added_o)
+{
+    size_t mask = table.capacity - 1;
+    size_t slot = dck_hash(key, key_size) & mask;
+
+    unsigned probe = 1;
+
+    for (; table.probes[slot] >= probe; ++probe, slot = (slot + 1) & mask) {
+        if (table.probes[slot] == probe &&
+            memcmp((char *)table.keys + slot * key_size, key, key_size) == 0) {
+            *added_o = 0;
+            return slot;
+        }
+    }
+
+    if (probe > UINT8_MAX)
+        return DCK_MAP_NONE;
+
+    size_t end = slot;
+
+    for (; table.probes[end]; end = (end + 1) & mask) {
+        if (table.probes[end] == UINT8_MAX)
+            return DCK_MAP_NONE;
+    }
+
+    for (; end != slot; end = (end - 1) & mask) {
+        size_t from = (end - 1) & mask;
+
+        memcpy((char *)table.keys   + end * key_size,   (char *)table.keys   + from * key_size,   key_size);
+        memcpy((char *)table.values + end * value_size, (char *)table.values + from * value_size, value_size);
+        table.probes[end] = table.probes[from] + 1;
+    }
+
+    memcpy((char *)table.keys + slot * key_size, key, key_size);
+    table.probes[slot] = (unsigned char)probe;
+
+    *added_o = 1;
+    return slot;
+}
+
+/* Places `key`, known to be missing, and returns its slot, DCK_MAP_NONE if a
+ * probe distance would overflow. Needs a free slot. Skips the key compares of
+ * `dck__map_insert`, and when keys come in home slot order, as they do from a
+ * table being rehashed, every one lands on a free slot without shifting.
+ */
+static inline size_t
+dck__map_place(dck__map_table_t table, size_t key_size, size_t value_size, const void *key)
+{
+    size_t mask = table.capacity - 1;
+    size_t slot = dck_hash(key, key_size) & mask;
+
+    unsigned probe = 1;
+
+    for (; table.probes[slot] >= probe; ++probe, slot = (slot + 1) & mask) { }
+
+    if (probe > UINT8_MAX)
+        return DCK_MAP_NONE;
+
+    size_t end = slot;
+
+    for (; table.probes[end]; end = (end + 1) & mask) {
+        if (table.probes[end] == UINT8_MAX)
+            return DCK_MAP_NONE;
+    }
+
+    for (; end != slot; end = (end - 1) & mask) {
+        size_t from = (end - 1) & mask;
+
+        memcpy((char *)table.keys   + end * key_size,   (char *)table.keys   + from * key_size,   key_size);
+        memcpy((char *)table.values + end * value_size, (char *)table.values + from * value_size, value_size);
+        table.probes[end] = table.probes[from] + 1;
+    }
+
+    memcpy((char *)table.keys + slot * key_size, key, key_size);
+    table.probes[slot] = (unsigned char)probe;
+
+    return slot;
+}
+
+/* Returns 1 if `key` was there. The entries after it shift back a slot. */
+static inline int
+dck__map_remove(dck__map_table_t table, size_t key_size, size_t value_size, const void *key)
+{
+    size_t slot = dck__map_find(table, key_size, key);
+
+    if (slot == DCK_MAP_NONE)
+        return 0;
+
+    size_t mask = table.capacity - 1;
+
+    for (size_t next = (slot + 1) & mask; table.probes[next] > 1; slot = next, next = (next + 1) & mask) {
+        memcpy((char *)table.keys   + slot * key_size,   (char *)table.keys   + next * key_size,   key_size);
+        memcpy((char *)table.values + slot * value_size, (char *)table.values + next * value_size, value_size);
+        table.probes[slot] = table.probes[next] - 1;
+    }
+
+    table.probes[slot] = 0;
+    return 1;
+}
+
+/* Moves the entries of `old` into a new table of at least `capacity` slots and
+ * frees it.
+ *
+ * The old table is walked from a free slot on, so whole runs go over in home
+ * slot order. Homes in the new table keep that order (per half when it
+ * doubled), so entries are appended to their runs instead of shifting them.
+ */
+static inline dck__map_table_t
+dck__map_rehash(dck__map_table_t old, size_t key_size, size_t value_size, size_t capacity)
+{
+    for (;; capacity *= 2) {
+        dck__map_table_t table = {
+            .keys     = mem_alloc(mem_tag(), capacity * key_size),
+            .values   = mem_alloc(mem_tag(), capacity * value_size),
+            .probes   = mem_calloc(mem_tag(), capacity, 1),
+            .capacity = capacity,
+        };
+
+        if (!table.keys || !table.values || !table.probes) {
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+            exit(666);
+        }
+
+        size_t start = 0;
+
+        while (start < old.capacity && old.probes[start]) {
+            ++start;
+        }
+
+        size_t i = 0;
+
+        for (; i < old.capacity; ++i) {
+            size_t from = (start + i) & (old.capacity - 1);
+
+            if (!old.probes[from])
+                continue;
+
+            size_t slot = dck__map_place(table, key_size, value_size, (char *)old.keys + from * key_size);
+
+            if (slot == DCK_MAP_NONE)
+                break;
+
+            memcpy((char *)table.values + slot * value_size, (char *)old.values + from * value_size, value_size);
+        }
+
+        if (i == old.capacity) {
+            mem_free(old.keys);
+            mem_free(old.values);
+            mem_free(old.probes);
+
+            return table;
+        }
+
+        mem_free(table.keys);
+        mem_free(table.values);
+        mem_free(table.probes);
+    }
+}
+
 
 #endif // DCK_H
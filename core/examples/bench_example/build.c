@@ -0,0 +1,44 @@
+#define BLD_IMPLEMENTATION
+#include "../../bld.h"
+
+#define INCL "-I../../"
+
+/* `avx` builds with -mavx2, `scalar` with LINA_NO_SIMD, the default is the
+ * plain target (SSE2 on x86-64). Only mat4 cares.
+ */
+int
+build_bench(const char *out, const char *src, int argc, char *argv[])
+{
+    printf("%s:\n", out);
+
+    const char *simd = bld_contains("avx", argc, argv)    ? "-mavx2"
+                     : bld_contains("scalar", argc, argv) ? "-DLINA_NO_SIMD"
+                     : NULL;
+
+    int res = simd ? BLD_CC(INCL, BLD_WARNINGS, "-O2", simd, src, "-o", out, "-lm")
+                   : BLD_CC(INCL, BLD_WARNINGS, "-O2", src, "-o", out, "-lm");
+    if (res) return res;
+
+    if (bld_contains("run", argc, argv))
+        return bld_run_program(out);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    BLD_TRY_REBUILD_SELF(argc, argv);
+
+    if (bld_contains("mat4", argc, argv))
+        return build_bench("mat4", "mat4.c", argc, argv);
+
+    if (bld_contains("map", argc, argv))
+        return build_bench("map", "map.c", argc, argv);
+
+    if (bld_contains("parse", argc, argv))
+        return build_bench("parse", "parse.c", argc, argv);
+
+    // default target
+    return build_bench("mat4", "mat4.c", argc, argv);
+}
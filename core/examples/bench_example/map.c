@@ -0,0 +1,234 @@
+#include "dck.h"
+
+#include <stdio.h>
+#include <time.h>
+
+/* Times dck_map_t against a naive chained map (FNV-1a, one malloc per node,
+ * grows at load 1) on random u64 keys with u32 values, then checks removes
+ * and iteration. The key count is the first argument, 1M by default.
+ */
+
+typedef struct chain_node
+{
+    uint64_t key;
+    uint32_t value;
+    struct chain_node *next;
+} chain_node_t;
+
+typedef struct
+{
+    chain_node_t **buckets;
+    size_t count;
+    size_t capacity;
+} chain_t;
+
+static volatile uint64_t sink;
+
+double
+now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+uint64_t
+fnv1a(const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+chain_node_t **
+chain_find(chain_t *chain, uint64_t key)
+{
+    chain_node_t **node = &chain->buckets[fnv1a(&key, sizeof(key)) & (chain->capacity - 1)];
+
+    while (*node && (*node)->key != key) {
+        node = &(*node)->next;
+    }
+
+    return node;
+}
+
+void
+chain_put(chain_t *chain, uint64_t key, uint32_t value)
+{
+    if (chain->count + 1 > chain->capacity) {
+        size_t capacity = chain->capacity ? chain->capacity * 2 : 16;
+        chain_node_t **buckets = calloc(capacity, sizeof(*buckets));
+
+        for (size_t i = 0; i < chain->capacity; ++i) {
+            for (chain_node_t *node = chain->buckets[i], *next; node; node = next) {
+                next = node->next;
+
+                size_t slot = fnv1a(&node->key, sizeof(node->key)) & (capacity - 1);
+                node->next = buckets[slot];
+                buckets[slot] = node;
+            }
+        }
+
+        free(chain->buckets);
+        chain->buckets = buckets;
+        chain->capacity = capacity;
+    }
+
+    chain_node_t **node = chain_find(chain, key);
+
+    if (*node) {
+        (*node)->value = value;
+        return;
+    }
+
+    *node = malloc(sizeof(**node));
+    **node = (chain_node_t) { .key = key, .value = value };
+    ++chain->count;
+}
+
+void
+chain_free(chain_t *chain)
+{
+    for (size_t i = 0; i < chain->capacity; ++i) {
+        for (chain_node_t *node = chain->buckets[i], *next; node; node = next) {
+            next = node->next;
+            free(node);
+        }
+    }
+
+    free(chain->buckets);
+    *chain = (chain_t) {0};
+}
+
+uint64_t
+xorshift(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+#define NS(start) ((now() - (start)) * 1e9 / count)
+
+int
+main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    uint64_t *keys   = malloc(count * sizeof(*keys));
+    uint64_t *misses = malloc(count * sizeof(*misses));
+
+    uint64_t state = 88172645463325252ull;
+
+    for (size_t i = 0; i < count; ++i) {
+        keys[i]   = xorshift(&state);
+        misses[i] = xorshift(&state);
+    }
+
+    // the first round warms up the allocator, only the second is printed
+    for (int round = 0; round < 2; ++round) {
+        dck_map_t(uint64_t, uint32_t, uint32_t) map = {0};
+        chain_t chain = {0};
+
+        double start = now();
+        for (size_t i = 0; i < count; ++i) {
+            dck_map_put(map, keys[i], (uint32_t)i);
+        }
+        double map_insert = NS(start);
+
+        start = now();
+        for (size_t i = 0; i < count; ++i) {
+            chain_put(&chain, keys[i], (uint32_t)i);
+        }
+        double chain_insert = NS(start);
+
+        start = now();
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t *value = dck_map_get(map, keys[i]);
+            sink += *value;
+        }
+        double map_hit = NS(start);
+
+        start = now();
+        for (size_t i = 0; i < count; ++i) {
+            sink += (*chain_find(&chain, keys[i]))->value;
+        }
+        double chain_hit = NS(start);
+
+        start = now();
+        for (size_t i = 0; i < count; ++i) {
+            sink += dck_map_get(map, misses[i]) != NULL;
+        }
+        double map_miss = NS(start);
+
+        start = now();
+        for (size_t i = 0; i < count; ++i) {
+            sink += *chain_find(&chain, misses[i]) != NULL;
+        }
+        double chain_miss = NS(start);
+
+        // refilling after a clear reuses the table
+        dck_map_clear(map);
+
+        start = now();
+        for (size_t i = 0; i < count; ++i) {
+            dck_map_put(map, keys[i], (uint32_t)i);
+        }
+        double map_refill = NS(start);
+
+        // presized from the expected count, fresh memory like the first insert
+        dck_map_t(uint64_t, uint32_t, uint32_t) reserved = {0};
+
+        start = now();
+        dck_map_reserve(reserved, count);
+        for (size_t i = 0; i < count; ++i) {
+            dck_map_put(reserved, keys[i], (uint32_t)i);
+        }
+        double map_reserved = NS(start);
+
+        dck_map_free(reserved);
+
+        for (size_t i = 0; i < count; i += 2) {
+            dck_map_remove(map, keys[i]);
+        }
+
+        size_t correct = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t *value = dck_map_get(map, keys[i]);
+            correct += (i & 1) ? value && *value == i : value == NULL;
+        }
+
+        size_t iterated = 0;
+        dck_map_for(map, slot) {
+            ++iterated;
+        }
+
+        if (round) {
+            printf("%zu keys, ns per operation\n", count);
+            printf("           map   chained\n");
+            printf("insert  %6.1f    %6.1f\n", map_insert, chain_insert);
+            printf("reserve %6.1f\n", map_reserved);
+            printf("refill  %6.1f\n", map_refill);
+            printf("hit     %6.1f    %6.1f\n", map_hit, chain_hit);
+            printf("miss    %6.1f    %6.1f\n", map_miss, chain_miss);
+            printf("remove: %s, iteration: %s\n",
+                   correct == count ? "ok" : "FAILED", iterated == count / 2 ? "ok" : "FAILED");
+        }
+
+        dck_map_free(map);
+        chain_free(&chain);
+    }
+
+    free(keys);
+    free(misses);
+
+    return 0;
+}
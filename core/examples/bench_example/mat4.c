@@ -0,0 +1,109 @@
+#include "lina.h"
+
+#include <stdio.h>
+#include <time.h>
+
+/* Times mat4_mul, mat4_inverse and mat4_transpose against their _scalar
+ * versions over a set of random matrices, and checks that both agree. Build
+ * with and without -mavx2 (or -DLINA_NO_SIMD) to compare the paths.
+ */
+
+#define MATRIX_COUNT 1024
+#define ROUNDS       2000
+
+static mat4_t matrices[MATRIX_COUNT];
+
+static volatile float sink;
+
+double
+now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+float
+max_diff(mat4_t a, mat4_t b)
+{
+    float max = 0.0f;
+
+    for (int i = 0; i < 16; ++i) {
+        float d = fabsf(a.data[i] - b.data[i]);
+        if (d > max) max = d;
+    }
+
+    return max;
+}
+
+float
+max_abs(mat4_t m)
+{
+    float max = 0.0f;
+
+    for (int i = 0; i < 16; ++i) {
+        if (fabsf(m.data[i]) > max) max = fabsf(m.data[i]);
+    }
+
+    return max;
+}
+
+#define BENCH(name, expr)                                                     \
+    do {                                                                      \
+        double start = now();                                                 \
+        for (int r = 0; r < ROUNDS; ++r) {                                    \
+            for (int i = 0; i < MATRIX_COUNT; ++i) {                          \
+                mat4_t m = expr;                                              \
+                sink += m.data[r & 15];                                       \
+            }                                                                 \
+        }                                                                     \
+        printf("%-18s %6.2f ns\n", name,                                      \
+               (now() - start) * 1e9 / ((double)ROUNDS * MATRIX_COUNT));      \
+    } while (0)
+
+int
+main(void)
+{
+    lina_rng_t rng = lina_rng_seed(1);
+
+    for (int i = 0; i < MATRIX_COUNT; ++i) {
+        for (int k = 0; k < 16; ++k) {
+            matrices[i].data[k] = lina_rng_float(&rng) * 2.0f - 1.0f;
+        }
+    }
+
+    float mul_diff = 0.0f, inverse_diff = 0.0f, transpose_diff = 0.0f;
+
+    for (int i = 0; i < MATRIX_COUNT; ++i) {
+        mat4_t a = matrices[i];
+        mat4_t b = matrices[(i * 7 + 3) % MATRIX_COUNT];
+
+        float d = max_diff(mat4_mul(a, b), mat4_mul_scalar(a, b));
+        if (d > mul_diff) mul_diff = d;
+
+        // relative, random matrices can be badly conditioned
+        mat4_t inverse = mat4_inverse_scalar(a);
+        float scale = max_abs(inverse);
+
+        d = max_diff(mat4_inverse(a), inverse) / (scale > 1.0f ? scale : 1.0f);
+        if (d > inverse_diff) inverse_diff = d;
+
+        d = max_diff(mat4_transpose(a), mat4_transpose_scalar(a));
+        if (d > transpose_diff) transpose_diff = d;
+    }
+
+    mat4_t t = mat4_mul(mat4_translation(1, 2, 3), mat4_rotation_y(0.3f));
+
+    printf("max difference to scalar: mul %g, inverse %g (relative), transpose %g\n",
+           mul_diff, inverse_diff, transpose_diff);
+    printf("M * inverse(M) - I: %g\n\n", max_diff(mat4_mul(t, mat4_inverse(t)), mat4_identity()));
+
+    BENCH("mul scalar",       mat4_mul_scalar(matrices[i], matrices[(i + 1) % MATRIX_COUNT]));
+    BENCH("mul",              mat4_mul(matrices[i], matrices[(i + 1) % MATRIX_COUNT]));
+    BENCH("inverse scalar",   mat4_inverse_scalar(matrices[i]));
+    BENCH("inverse",          mat4_inverse(matrices[i]));
+    BENCH("transpose scalar", mat4_transpose_scalar(matrices[i]));
+    BENCH("transpose",        mat4_transpose(matrices[i]));
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+#define PARSE_IMPLEMENTATION
+#include "parse.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Times parse_int and parse_index_triplet against parse_simple_int on
+ * random OBJ face records (`f v/vt/vn v/vt/vn v/vt/vn`), and checks that
+ * they agree. The triplet baseline splits corners on '/' and parses each
+ * index with parse_simple_int, the way the OBJ importer used to.
+ */
+
+#define TEXT_SIZE (32u << 20)
+#define ROUNDS    5
+
+static volatile long long sink;
+
+double
+now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Face records up to `size` bytes, indices from 1 to 10^7, a few relative. */
+char *
+make_faces(size_t size, size_t *length_o)
+{
+    char *text = malloc(size + 64);
+    size_t length = 0;
+    unsigned state = 1;
+
+    while (length < size - 128) {
+        length += sprintf(text + length, "f");
+
+        for (int i = 0; i < 3; ++i) {
+            int v[3];
+
+            for (int k = 0; k < 3; ++k) {
+                state = state * 1103515245u + 12345u;
+                v[k] = (int)((state >> 8) % 10000000u) + 1;
+
+                if ((state & 0xff) < 8) {
+                    v[k] = -(v[k] % 100 + 1);
+                }
+            }
+
+            length += sprintf(text + length, " %d/%d/%d", v[0], v[1], v[2]);
+        }
+
+        text[length++] = '\n';
+    }
+
+    *length_o = length;
+    return text;
+}
+
+/* Skips to the next digit or sign, the separators between ints. */
+static inline const char *
+skip_separators(const char *at, const char *end)
+{
+    while (at != end && !(is_digit(*at) || *at == '-' || *at == '+')) {
+        ++at;
+    }
+
+    return at;
+}
+
+long long
+sum_simple_int(const char *text, const char *end)
+{
+    long long sum = 0;
+    char *next;
+
+    for (const char *at = skip_separators(text, end); at != end; at = skip_separators(next, end)) {
+        sum += parse_simple_int(at, end, &next);
+    }
+
+    return sum;
+}
+
+long long
+sum_int(const char *text, const char *end)
+{
+    long long sum = 0;
+    char *next;
+
+    for (const char *at = skip_separators(text, end); at != end; at = skip_separators(next, end)) {
+        sum += parse_int(at, end, &next);
+    }
+
+    return sum;
+}
+
+/* One corner with parse_simple_int per component. */
+static inline int
+simple_triplet(const char **at, const char *end, parse_triplet_t *triplet_o)
+{
+    int *fields[3] = { &triplet_o->v, &triplet_o->vt, &triplet_o->vn };
+
+    *triplet_o = (parse_triplet_t) {0};
+
+    while (*at != end && is_space(**at)) {
+        ++*at;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        if (i > 0) {
+            if (*at == end || **at != '/')
+                break;
+            ++*at;
+        }
+
+        if (*at == end || !(is_digit(**at) || **at == '-' || **at == '+'))
+            continue;
+
+        char *next;
+        *fields[i] = parse_simple_int(*at, end, &next);
+        *at = next;
+    }
+
+    return triplet_o->v != 0;
+}
+
+long long
+sum_simple_triplets(const char *text, const char *end)
+{
+    long long sum = 0;
+
+    for (const char *at = text; at < end; ) {
+        at += 1; // 'f'
+
+        parse_triplet_t triplet;
+
+        while (simple_triplet(&at, end, &triplet)) {
+            sum += triplet.v + 3ll * triplet.vt + 7ll * triplet.vn;
+        }
+
+        at += 1; // '\n'
+    }
+
+    return sum;
+}
+
+long long
+sum_triplets(const char *text, const char *end)
+{
+    long long sum = 0;
+
+    for (const char *at = text; at < end; ) {
+        at += 1;
+
+        parse_triplet_t triplet;
+        char *next;
+
+        while (parse_index_triplet(at, end, &triplet, &next)) {
+            sum += triplet.v + 3ll * triplet.vt + 7ll * triplet.vn;
+            at = next;
+        }
+
+        at += 1;
+    }
+
+    return sum;
+}
+
+void
+bench(const char *name, long long (*fn)(const char *, const char *), const char *text, size_t length)
+{
+    double best = 1e9;
+    long long sum = 0;
+
+    for (int r = 0; r < ROUNDS; ++r) {
+        double start = now();
+        sum = fn(text, text + length);
+        double time = now() - start;
+
+        if (time < best) best = time;
+    }
+
+    sink += sum;
+    printf("%-22s %7.1f MB/s  sum %lld\n", name, length / best / 1e6, sum);
+}
+
+int
+main(void)
+{
+    size_t length;
+    char *text = make_faces(TEXT_SIZE, &length);
+
+    printf("%zu bytes of face records\n", length);
+
+    bench("parse_simple_int",     sum_simple_int,      text, length);
+    bench("parse_int",            sum_int,             text, length);
+    bench("triplet, simple_int",  sum_simple_triplets, text, length);
+    bench("parse_index_triplet",  sum_triplets,        text, length);
+
+    free(text);
+
+    return 0;
+}
@@ -5,12 +5,95 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-/* Returns a pointer to allocated memory with the contents of file at `path`.
- * The size of the file gets written at `size_o`, unless it's NULL.
- * On error returns NULL pointer.
+#include "mem.h"
+
+/* Returns a pointer to allocated memory with the contents of file at `path`,
+ * release it with `mem_free`. The size of the file gets written at `size_o`,
+ * unless it's NULL. On error returns NULL pointer.
  */
 unsigned char *io_read_file(const char *path, size_t *size_o);
 
+typedef enum
+{
+    io_map_None       = 0,
+    io_map_Sequential = (1 << 0), // will be read front to back, read ahead aggressively
+    io_map_WillNeed   = (1 << 1), // start paging in the whole file right away
+} io_map_flags_t;
+
+/* Read-only view of a whole file. `begin` and `end` line up with `sv_t`.
+ * `mapped` is false when the contents had to be read into a heap buffer.
+ */
+typedef struct
+{
+    char *begin, *end;
+    int mapped;
+} io_map_t;
+
+/* Maps the file at `path` read-only into `map_o`, `flags` are io_map_flags_t
+ * hints. Where mapping isn't available (no mmap, not a regular file) falls
+ * back to `io_read_file`. Returns 0 on error. An empty file gives an empty
+ * view. Release with `io_unmap_file`.
+ */
+int io_map_file(const char *path, unsigned flags, io_map_t *map_o);
+
+void io_unmap_file(io_map_t *map);
+
+static inline size_t io_map_size(io_map_t map)
+{
+    return map.end - map.begin;
+}
+
+#define IO_WRITER_DEFAULT_CAPACITY (4 << 20)
+
+/* Buffered file writer. Small writes are gathered in `buffer`, writes of at
+ * least half the capacity go out together with the pending buffer in a
+ * single writev, without being copied. Errors are sticky: after the first
+ * failure writes are dropped and `io_writer_close` reports it.
+ */
+typedef struct
+{
+    int   fd;
+    FILE *file; // used where writev isn't available
+
+    char  *buffer;
+    size_t capacity;
+    size_t used;
+
+    int error;
+} io_writer_t;
+
+/* Creates (or truncates) the file at `path`. A `capacity` of 0 picks
+ * IO_WRITER_DEFAULT_CAPACITY. Returns 0 on error.
+ */
+int io_writer_open(io_writer_t *writer_o, const char *path, size_t capacity);
+
+/* Flushes, closes the file and frees the buffer. Returns 0 if anything
+ * written through `writer` failed.
+ */
+int io_writer_close(io_writer_t *writer);
+
+void io_writer_flush(io_writer_t *writer);
+
+void io_writer_write(io_writer_t *writer, const void *data, size_t size);
+
+/* Returns space for up to `size` bytes (at most the capacity) at the end of
+ * the buffer, to be formatted into directly and then passed to
+ * `io_writer_commit` with the number of bytes actually used.
+ */
+static inline char *io_writer_reserve(io_writer_t *writer, size_t size)
+{
+    if (writer->capacity - writer->used < size) {
+        io_writer_flush(writer);
+    }
+
+    return writer->buffer + writer->used;
+}
+
+static inline void io_writer_commit(io_writer_t *writer, size_t size)
+{
+    writer->used += size;
+}
+
 #define IO_FREAD(buffer, size, count, stream) \
 do { \
     if (fread(buffer, size, count, stream) != (size_t)count) { \
@@ -26,13 +109,31 @@ do { \
         fprintf(stderr, "%s:%d: fwrite failure! exiting...\n", __FILE__, __LINE__); \
         exit(1); \
     } \
-while (0)
+} while(0)
 
 
 #if defined(IO_IMPLEMENTATION)
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define IO_MMAP 1
+
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+
+    #define IO_WRITEV 1
+
+    #include <sys/uio.h>
+    #include <errno.h>
+#else
+    #define IO_MMAP 0
+    #define IO_WRITEV 0
+#endif
 
 
 unsigned char *io_read_file(const char *path, size_t *size_o)
@@ -53,7 +154,7 @@ unsigned char *io_read_file(const char *path, size_t *size_o)
 
     rewind(file);
 
-    contents = malloc(size);
+    contents = mem_alloc(mem_Io, size);
 
     if (!contents)
         goto error_exit;
@@ -71,11 +172,228 @@ error_exit:
         fclose(file);
     }
 
-    free(contents);
+    mem_free(contents);
 
     return NULL;
 }
 
+static int io_map_file_read(const char *path, io_map_t *map_o)
+{
+    size_t size;
+    unsigned char *data = io_read_file(path, &size);
+
+    if (!data)
+        return 0;
+
+    *map_o = (io_map_t) {
+        .begin  = (char *)data,
+        .end    = (char *)data + size,
+        .mapped = 0,
+    };
+
+    return 1;
+}
+
+int io_map_file(const char *path, unsigned flags, io_map_t *map_o)
+{
+#if IO_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return 0;
+
+    struct stat st;
+
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return io_map_file_read(path, map_o);
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        *map_o = (io_map_t) {0};
+        return 1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return io_map_file_read(path, map_o);
+
+    if (flags & io_map_Sequential) {
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+    }
+
+    if (flags & io_map_WillNeed) {
+        madvise(data, st.st_size, MADV_WILLNEED);
+    }
+
+    *map_o = (io_map_t) {
+        .begin  = data,
+        .end    = (char *)data + st.st_size,
+        .mapped = 1,
+    };
+
+    return 1;
+#else
+    (void)flags;
+    return io_map_file_read(path, map_o);
+#endif
+}
+
+void io_unmap_file(io_map_t *map)
+{
+#if IO_MMAP
+    if (map->mapped) {
+        munmap(map->begin, map->end - map->begin);
+    }
+    else {
+        mem_free(map->begin);
+    }
+#else
+    mem_free(map->begin);
+#endif
+
+    *map = (io_map_t) {0};
+}
+
+int io_writer_open(io_writer_t *writer_o, const char *path, size_t capacity)
+{
+    *writer_o = (io_writer_t) { .fd = -1 };
+
+    if (!capacity) {
+        capacity = IO_WRITER_DEFAULT_CAPACITY;
+    }
+
+    char *buffer = mem_alloc(mem_Io, capacity);
+    if (!buffer)
+        return 0;
+
+#if IO_WRITEV
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) {
+        mem_free(buffer);
+        return 0;
+    }
+
+    writer_o->fd = fd;
+#else
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        mem_free(buffer);
+        return 0;
+    }
+
+    writer_o->file = file;
+#endif
+
+    writer_o->buffer   = buffer;
+    writer_o->capacity = capacity;
+
+    return 1;
+}
+
+#if IO_WRITEV
+/* Writes all of `iov`, retrying on short writes and interrupts. */
+static int io_writer_writev(int fd, struct iovec *iov, int count)
+{
+    while (count) {
+        ssize_t written = writev(fd, iov, count);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return 0;
+        }
+
+        while (count && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 1;
+}
+#endif
+
+/* Writes the pending buffer followed by `data`. */
+static void io_writer_send(io_writer_t *writer, const void *data, size_t size)
+{
+    if (writer->error) {
+        writer->used = 0;
+        return;
+    }
+
+#if IO_WRITEV
+    struct iovec iov[2] = {
+        { .iov_base = writer->buffer,  .iov_len = writer->used },
+        { .iov_base = (void *)data,    .iov_len = size         },
+    };
+
+    if (!io_writer_writev(writer->fd, iov, 2)) {
+        writer->error = 1;
+    }
+#else
+    if (fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used ||
+        fwrite(data, 1, size, writer->file) != size) {
+        writer->error = 1;
+    }
+#endif
+
+    writer->used = 0;
+}
+
+void io_writer_flush(io_writer_t *writer)
+{
+    if (writer->used) {
+        io_writer_send(writer, NULL, 0);
+    }
+}
+
+void io_writer_write(io_writer_t *writer, const void *data, size_t size)
+{
+    if (size >= writer->capacity / 2) {
+        io_writer_send(writer, data, size);
+        return;
+    }
+
+    if (writer->capacity - writer->used < size) {
+        io_writer_flush(writer);
+    }
+
+    memcpy(writer->buffer + writer->used, data, size);
+    writer->used += size;
+}
+
+int io_writer_close(io_writer_t *writer)
+{
+    io_writer_flush(writer);
+
+#if IO_WRITEV
+    if (writer->fd != -1 && close(writer->fd)) {
+        writer->error = 1;
+    }
+#else
+    if (writer->file && fclose(writer->file)) {
+        writer->error = 1;
+    }
+#endif
+
+    int ok = !writer->error;
+
+    mem_free(writer->buffer);
+    *writer = (io_writer_t) { .fd = -1 };
+
+    return ok;
+}
+
 #endif // defined(IO_IMPLEMENTATION)
 
 
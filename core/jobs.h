@@ -0,0 +1,264 @@
+#ifndef JOBS_H_
+#define JOBS_H_
+
+/* Small pthread job pool.
+ *
+ * Jobs are plain function + argument pairs run in push order by a fixed set
+ * of worker threads. Completion is tracked per job through a caller owned
+ * `jobs_done_t`. A thread waiting in `jobs_wait` runs queued jobs itself
+ * instead of sleeping, so waiting from inside a job can't deadlock the pool,
+ * and a pool with no workers still works (everything runs in the waits).
+ */
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define JOBS_MAX_THREADS 64
+
+typedef void (*jobs_fn_t)(void *arg);
+
+/* Completion flag of one job, only touched under the pool's lock. */
+typedef struct
+{
+    int done;
+} jobs_done_t;
+
+typedef struct
+{
+    jobs_fn_t    fn;
+    void        *arg;
+    jobs_done_t *done;
+} jobs_job_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;     // a job was queued, or the pool is stopping
+    pthread_cond_t  finished; // a job finished
+
+    jobs_job_t *queue;        // ring buffer
+    size_t      head;
+    size_t      count;
+    size_t      capacity;
+
+    size_t running;
+    int    stop;
+
+    pthread_t threads[JOBS_MAX_THREADS];
+    unsigned  thread_count;
+} jobs_t;
+
+/* Starts `thread_count` workers, 0 picks one per online CPU minus the
+ * calling thread, but at least one, so the caller can get on with other
+ * work. Returns 0 on error.
+ */
+int
+jobs_init(jobs_t *jobs, unsigned thread_count);
+
+/* Waits for every queued job, then stops and joins the workers. */
+void
+jobs_destroy(jobs_t *jobs);
+
+/* Queues `fn(arg)`. `done`, if not NULL, is cleared here and set once the
+ * job returned.
+ */
+void
+jobs_push(jobs_t *jobs, jobs_fn_t fn, void *arg, jobs_done_t *done);
+
+/* Returns once the job owning `done` finished. With a NULL `done` returns
+ * once the queue drained and nothing is running. Runs queued jobs in the
+ * meantime.
+ */
+void
+jobs_wait(jobs_t *jobs, jobs_done_t *done);
+
+
+#if defined(JOBS_IMPLEMENTATION)
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <unistd.h>
+
+static int
+jobs_pop(jobs_t *jobs, jobs_job_t *job_o)
+{
+    if (!jobs->count)
+        return 0;
+
+    *job_o = jobs->queue[jobs->head];
+
+    jobs->head = (jobs->head + 1) % jobs->capacity;
+    jobs->count -= 1;
+    jobs->running += 1;
+
+    return 1;
+}
+
+/* Runs `job` with the lock released, takes it back before returning. */
+static void
+jobs_run(jobs_t *jobs, jobs_job_t job)
+{
+    pthread_mutex_unlock(&jobs->lock);
+    job.fn(job.arg);
+    pthread_mutex_lock(&jobs->lock);
+
+    jobs->running -= 1;
+
+    if (job.done) {
+        job.done->done = 1;
+    }
+
+    pthread_cond_broadcast(&jobs->finished);
+}
+
+static void *
+jobs_worker(void *arg)
+{
+    jobs_t *jobs = arg;
+
+    pthread_mutex_lock(&jobs->lock);
+
+    for (;;) {
+        jobs_job_t job;
+
+        if (jobs_pop(jobs, &job)) {
+            jobs_run(jobs, job);
+        }
+        else if (jobs->stop) {
+            break;
+        }
+        else {
+            pthread_cond_wait(&jobs->wake, &jobs->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&jobs->lock);
+
+    return NULL;
+}
+
+int
+jobs_init(jobs_t *jobs, unsigned thread_count)
+{
+    *jobs = (jobs_t) {0};
+
+    if (!thread_count) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 1 ? (unsigned)cpus - 1 : 1;
+    }
+
+    if (thread_count > JOBS_MAX_THREADS) {
+        thread_count = JOBS_MAX_THREADS;
+    }
+
+    if (pthread_mutex_init(&jobs->lock, NULL))
+        return 0;
+
+    if (pthread_cond_init(&jobs->wake, NULL)) {
+        pthread_mutex_destroy(&jobs->lock);
+        return 0;
+    }
+
+    if (pthread_cond_init(&jobs->finished, NULL)) {
+        pthread_cond_destroy(&jobs->wake);
+        pthread_mutex_destroy(&jobs->lock);
+        return 0;
+    }
+
+    // fewer workers than asked for is fine, the waits pick up the slack
+    for (unsigned i = 0; i < thread_count; ++i) {
+        if (pthread_create(&jobs->threads[jobs->thread_count], NULL, jobs_worker, jobs))
+            break;
+
+        jobs->thread_count += 1;
+    }
+
+    return 1;
+}
+
+void
+jobs_destroy(jobs_t *jobs)
+{
+    jobs_wait(jobs, NULL);
+
+    pthread_mutex_lock(&jobs->lock);
+    jobs->stop = 1;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+
+    for (unsigned i = 0; i < jobs->thread_count; ++i) {
+        pthread_join(jobs->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&jobs->finished);
+    pthread_cond_destroy(&jobs->wake);
+    pthread_mutex_destroy(&jobs->lock);
+
+    free(jobs->queue);
+
+    *jobs = (jobs_t) {0};
+}
+
+void
+jobs_push(jobs_t *jobs, jobs_fn_t fn, void *arg, jobs_done_t *done)
+{
+    pthread_mutex_lock(&jobs->lock);
+
+    if (jobs->count == jobs->capacity) {
+        size_t capacity = jobs->capacity ? jobs->capacity * 2 : 16;
+
+        jobs_job_t *queue = malloc(capacity * sizeof(*queue));
+        if (!queue) {
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+            exit(666);
+        }
+
+        // unwrap the ring into the front of the new buffer
+        for (size_t i = 0; i < jobs->count; ++i) {
+            queue[i] = jobs->queue[(jobs->head + i) % jobs->capacity];
+        }
+
+        free(jobs->queue);
+
+        jobs->queue    = queue;
+        jobs->head     = 0;
+        jobs->capacity = capacity;
+    }
+
+    if (done) {
+        done->done = 0;
+    }
+
+    jobs->queue[(jobs->head + jobs->count) % jobs->capacity] = (jobs_job_t) { fn, arg, done };
+    jobs->count += 1;
+
+    pthread_cond_signal(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+}
+
+void
+jobs_wait(jobs_t *jobs, jobs_done_t *done)
+{
+    pthread_mutex_lock(&jobs->lock);
+
+    for (;;) {
+        if (done ? done->done : !jobs->count && !jobs->running)
+            break;
+
+        jobs_job_t job;
+
+        if (jobs_pop(jobs, &job)) {
+            jobs_run(jobs, job);
+        }
+        else {
+            pthread_cond_wait(&jobs->finished, &jobs->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&jobs->lock);
+}
+
+#endif // defined(JOBS_IMPLEMENTATION)
+
+#endif // JOBS_H_
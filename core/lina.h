@@ -7,9 +7,35 @@
     #define M_PI 3.14159265358979323846
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
+/* mat4_mul, mat4_inverse and mat4_transpose use SSE2, and AVX for the
+ * multiply, when the target has them, lina_rng_fill uses SSE2 or AVX2, the
+ * batch functions SSE2 or AVX.
+ * Define LINA_NO_SIMD to always get the scalar versions, which stay
+ * available as the _scalar functions either way.
+ */
+#if !defined(LINA_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define LINA_SSE2
+    #include <emmintrin.h>
+
+    #if defined(__AVX__)
+        #define LINA_AVX
+        #include <immintrin.h>
+    #endif
+
+    #if defined(__AVX2__)
+        #define LINA_AVX2
+    #endif
+#endif
+
+/* Column major, like OpenGL and raylib's Matrix: the translation is in
+ * data[12..14]. Aligned so the SIMD paths can load columns directly.
+ */
 typedef struct
 {
-    float data[16];
+    _Alignas(16) float data[16];
 } mat4_t;
 
 /* https://nlguillemot.wordpress.com/2016/12/07/reversed-z-in-opengl/
@@ -21,25 +47,25 @@ static inline mat4_t mat4_rz_projection(float y_fov_r, float w, float h, float n
     float asp = w / h;
     float f = 1.0f / tanf(y_fov_r / 2.0f);
 
-    return (mat4_t) {
+    return (mat4_t) {{
         f / asp, 0.0f, 0.0f, 0.0f,
         0.0f,    f,    0.0f, 0.0f,
         0.0f,    0.0f, 0.0f,-1.0f,
         0.0f,    0.0f, near, 0.0f,
-    };
+    }};
 }
 
 static inline mat4_t mat4_identity(void)
 {
-    return (mat4_t) {
+    return (mat4_t) {{
          1.0f, 0.0f, 0.0f, 0.0f,
          0.0f, 1.0f, 0.0f, 0.0f,
          0.0f, 0.0f, 1.0f, 0.0f,
          0.0f, 0.0f, 0.0f, 1.0f,
-    };
+    }};
 }
 
-static inline mat4_t mat4_transpose(mat4_t m)
+static inline mat4_t mat4_transpose_scalar(mat4_t m)
 {
     mat4_t res;
 
@@ -63,7 +89,7 @@ static inline mat4_t mat4_transpose(mat4_t m)
  *
  * http://oss.sgi.com/projects/FreeB/
  */
-static inline mat4_t mat4_inverse(mat4_t mat)
+static inline mat4_t mat4_inverse_scalar(mat4_t mat)
 {
     mat4_t res;
 
@@ -119,54 +145,54 @@ static inline mat4_t mat4_inverse(mat4_t mat)
 
 static inline mat4_t mat4_scale(float x, float y, float z)
 {
-    return (mat4_t) {
+    return (mat4_t) {{
          x,    0.0f, 0.0f, 0.0f,
          0.0f, y,    0.0f, 0.0f,
          0.0f, 0.0f, z,    0.0f,
          0.0f, 0.0f, 0.0f, 1.0f,
-    };
+    }};
 }
 
 static inline mat4_t mat4_translation(float x, float y, float z)
 {
-    return (mat4_t) {
+    return (mat4_t) {{
          1.0f, 0.0f, 0.0f, 0.0f,
          0.0f, 1.0f, 0.0f, 0.0f,
          0.0f, 0.0f, 1.0f, 0.0f,
          x,    y,    z,    1.0f,
-    };
+    }};
 }
 
 static inline mat4_t mat4_rotation_x(float angle)
 {
-    return (mat4_t) {
+    return (mat4_t) {{
          1.0f, 0.0f,        0.0f,        0.0f,
          0.0f, cosf(angle), sinf(angle), 0.0f,
          0.0f,-sinf(angle), cosf(angle), 0.0f,
          0.0f, 0.0f,        0.0f,        1.0f,
-    };
+    }};
 }
 
 static inline mat4_t mat4_rotation_y(float angle)
 {
-    return (mat4_t) {
+    return (mat4_t) {{
          cosf(angle), 0.0f,-sinf(angle), 0.0f,
          0.0f,        1.0f, 0.0f,        0.0f,
          sinf(angle), 0.0f, cosf(angle), 0.0f,
          0.0f,        0.0f, 0.0f,        1.0f,
-    };
+    }};
 }
 static inline mat4_t mat4_rotation_z(float angle)
 {
-    return (mat4_t) {
+    return (mat4_t) {{
          cosf(angle), sinf(angle), 0.0f, 0.0f,
         -sinf(angle), cosf(angle), 0.0f, 0.0f,
          0.0f,        0.0f,        1.0f, 0.0f,
          0.0f,        0.0f,        0.0f, 1.0f,
-    };
+    }};
 }
 
-static inline mat4_t mat4_mul(mat4_t mat1, mat4_t mat2)
+static inline mat4_t mat4_mul_scalar(mat4_t mat1, mat4_t mat2)
 {
     const float *m1 = mat1.data;
     const float *m2 = mat2.data;
@@ -187,6 +213,179 @@ static inline mat4_t mat4_mul(mat4_t mat1, mat4_t mat2)
     return res;
 }
 
+#if defined(LINA_SSE2)
+
+#define LINA_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define LINA_SWIZZLE(a, x, y, z, w) \
+    _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(w, z, y, x)))
+
+/* 2x2 matrices packed in one register as (m00, m01, m10, m11). */
+static inline __m128 lina__mat2_mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, LINA_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(LINA_SWIZZLE(a, 1, 0, 3, 2), LINA_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+/* adj(a) * b */
+static inline __m128 lina__mat2_adj_mul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(LINA_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(LINA_SWIZZLE(a, 1, 1, 2, 2), LINA_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+/* a * adj(b) */
+static inline __m128 lina__mat2_mul_adj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, LINA_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(LINA_SWIZZLE(a, 1, 0, 3, 2), LINA_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+#endif
+
+static inline mat4_t mat4_transpose(mat4_t m)
+{
+#if defined(LINA_SSE2)
+    __m128 c0 = _mm_load_ps(m.data + 0);
+    __m128 c1 = _mm_load_ps(m.data + 4);
+    __m128 c2 = _mm_load_ps(m.data + 8);
+    __m128 c3 = _mm_load_ps(m.data + 12);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    mat4_t res;
+
+    _mm_store_ps(res.data + 0,  c0);
+    _mm_store_ps(res.data + 4,  c1);
+    _mm_store_ps(res.data + 8,  c2);
+    _mm_store_ps(res.data + 12, c3);
+
+    return res;
+#else
+    return mat4_transpose_scalar(m);
+#endif
+}
+
+/* Block inverse through 2x2 sub-matrices and their adjugates, see
+ * https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+ *
+ * Inverting the transpose gives the transposed inverse, so the row major
+ * derivation works on column major data as is. A singular matrix is returned
+ * unchanged, like the scalar version does.
+ */
+static inline mat4_t mat4_inverse(mat4_t mat)
+{
+#if defined(LINA_SSE2)
+    __m128 c0 = _mm_load_ps(mat.data + 0);
+    __m128 c1 = _mm_load_ps(mat.data + 4);
+    __m128 c2 = _mm_load_ps(mat.data + 8);
+    __m128 c3 = _mm_load_ps(mat.data + 12);
+
+    __m128 a = _mm_movelh_ps(c0, c1);
+    __m128 b = _mm_movehl_ps(c1, c0);
+    __m128 c = _mm_movelh_ps(c2, c3);
+    __m128 d = _mm_movehl_ps(c3, c2);
+
+    // (|a|, |b|, |c|, |d|)
+    __m128 det_sub = _mm_sub_ps(
+        _mm_mul_ps(LINA_SHUFFLE(c0, c2, 0, 2, 0, 2), LINA_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+        _mm_mul_ps(LINA_SHUFFLE(c0, c2, 1, 3, 1, 3), LINA_SHUFFLE(c1, c3, 0, 2, 0, 2))
+    );
+
+    __m128 det_a = LINA_SWIZZLE(det_sub, 0, 0, 0, 0);
+    __m128 det_b = LINA_SWIZZLE(det_sub, 1, 1, 1, 1);
+    __m128 det_c = LINA_SWIZZLE(det_sub, 2, 2, 2, 2);
+    __m128 det_d = LINA_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+    __m128 d_c = lina__mat2_adj_mul(d, c);
+    __m128 a_b = lina__mat2_adj_mul(a, b);
+
+    __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), lina__mat2_mul(b, d_c));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), lina__mat2_mul(c, a_b));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), lina__mat2_mul_adj(d, a_b));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), lina__mat2_mul_adj(a, d_c));
+
+    // |m| = |a||d| + |b||c| - tr(adj(a) b adj(d) c)
+    __m128 tr = _mm_mul_ps(a_b, LINA_SWIZZLE(d_c, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, LINA_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, LINA_SWIZZLE(tr, 1, 0, 3, 2));
+
+    __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+
+    if (_mm_cvtss_f32(det) == 0.0f)
+        return mat;
+
+    __m128 rdet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+
+    x = _mm_mul_ps(x, rdet);
+    y = _mm_mul_ps(y, rdet);
+    z = _mm_mul_ps(z, rdet);
+    w = _mm_mul_ps(w, rdet);
+
+    mat4_t res;
+
+    _mm_store_ps(res.data + 0,  LINA_SHUFFLE(x, y, 3, 1, 3, 1));
+    _mm_store_ps(res.data + 4,  LINA_SHUFFLE(x, y, 2, 0, 2, 0));
+    _mm_store_ps(res.data + 8,  LINA_SHUFFLE(z, w, 3, 1, 3, 1));
+    _mm_store_ps(res.data + 12, LINA_SHUFFLE(z, w, 2, 0, 2, 0));
+
+    return res;
+#else
+    return mat4_inverse_scalar(mat);
+#endif
+}
+
+/* mat1 * mat2, each result column is a combination of the columns of mat1
+ * weighted by a column of mat2. AVX does two result columns at once.
+ */
+static inline mat4_t mat4_mul(mat4_t mat1, mat4_t mat2)
+{
+#if defined(LINA_AVX)
+    __m256 a0 = _mm256_broadcast_ps((const __m128 *)(mat1.data + 0));
+    __m256 a1 = _mm256_broadcast_ps((const __m128 *)(mat1.data + 4));
+    __m256 a2 = _mm256_broadcast_ps((const __m128 *)(mat1.data + 8));
+    __m256 a3 = _mm256_broadcast_ps((const __m128 *)(mat1.data + 12));
+
+    mat4_t res;
+
+    for (int j = 0; j < 16; j += 8) {
+        // 128-bit halves, callers pass and read matrices by value through
+        // 16-byte stack slots and a whole 256-bit access stalls forwarding
+        __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(mat2.data + j)),
+                                        _mm_load_ps(mat2.data + j + 4), 1);
+
+        __m256 r =            _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, 0x00));
+        r = _mm256_add_ps(r,  _mm256_mul_ps(a1, _mm256_shuffle_ps(b, b, 0x55)));
+        r = _mm256_add_ps(r,  _mm256_mul_ps(a2, _mm256_shuffle_ps(b, b, 0xaa)));
+        r = _mm256_add_ps(r,  _mm256_mul_ps(a3, _mm256_shuffle_ps(b, b, 0xff)));
+
+        _mm_store_ps(res.data + j,     _mm256_castps256_ps128(r));
+        _mm_store_ps(res.data + j + 4, _mm256_extractf128_ps(r, 1));
+    }
+
+    return res;
+#elif defined(LINA_SSE2)
+    __m128 a0 = _mm_load_ps(mat1.data + 0);
+    __m128 a1 = _mm_load_ps(mat1.data + 4);
+    __m128 a2 = _mm_load_ps(mat1.data + 8);
+    __m128 a3 = _mm_load_ps(mat1.data + 12);
+
+    mat4_t res;
+
+    for (int j = 0; j < 16; j += 4) {
+        __m128 r =         _mm_mul_ps(a0, _mm_set1_ps(mat2.data[j + 0]));
+        r = _mm_add_ps(r,  _mm_mul_ps(a1, _mm_set1_ps(mat2.data[j + 1])));
+        r = _mm_add_ps(r,  _mm_mul_ps(a2, _mm_set1_ps(mat2.data[j + 2])));
+        r = _mm_add_ps(r,  _mm_mul_ps(a3, _mm_set1_ps(mat2.data[j + 3])));
+
+        _mm_store_ps(res.data + j, r);
+    }
+
+    return res;
+#else
+    return mat4_mul_scalar(mat1, mat2);
+#endif
+}
+
 
 typedef struct
 {
@@ -304,6 +503,229 @@ static inline float vec3_dot(vec3_t a, vec3_t b)
 }
 
 
+/* Affine transform, the top three rows of a column major mat4_t: columns x, y
+ * and z of the linear part, then the translation. The implied last row is
+ * (0 0 0 1), so composing costs 36 multiplies instead of 64, and the normal
+ * matrix comes straight from cross products of the columns instead of a
+ * general inverse. Convert with affine_to_mat4 where a 4x4 is needed.
+ */
+typedef struct
+{
+    float data[12];
+} affine_t;
+
+static inline affine_t affine_identity(void)
+{
+    return (affine_t) {{
+        1.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f,
+        0.0f, 0.0f, 0.0f,
+    }};
+}
+
+/* Scales, rotates by `angle` radians around `axis` (normalized here), then
+ * translates. Multiples of 90 degrees around a principal axis come out as
+ * exact signed permutations, see affine_axes.
+ */
+static inline affine_t affine_trs(vec3_t translation, vec3_t axis, float angle, vec3_t scale)
+{
+    float x = axis.x, y = axis.y, z = axis.z;
+    float length_sq = x * x + y * y + z * z;
+
+    if (length_sq != 1.0f && length_sq != 0.0f) {
+        float inv_length = 1.0f / sqrtf(length_sq);
+        x *= inv_length;
+        y *= inv_length;
+        z *= inv_length;
+    }
+
+    // quarter turns get exact sines and cosines, cosf of a float pi/2 is
+    // -4.4e-8 and would leak into the other axes
+    float quarters = angle * (float)(2.0 / M_PI);
+    float rounded  = roundf(quarters);
+
+    float s, c;
+
+    if (fabsf(quarters - rounded) < 1e-5f && fabsf(rounded) < 1e6f) {
+        static const float sines[4]   = { 0.0f, 1.0f,  0.0f, -1.0f };
+        static const float cosines[4] = { 1.0f, 0.0f, -1.0f,  0.0f };
+
+        int quarter = ((int)rounded % 4 + 4) % 4;
+
+        s = sines[quarter];
+        c = cosines[quarter];
+    }
+    else {
+        s = sinf(angle);
+        c = cosf(angle);
+    }
+
+    float t = 1.0f - c;
+
+    return (affine_t) {{
+        (x * x * t + c)     * scale.x, (y * x * t + z * s) * scale.x, (z * x * t - y * s) * scale.x,
+        (x * y * t - z * s) * scale.y, (y * y * t + c)     * scale.y, (z * y * t + x * s) * scale.y,
+        (x * z * t + y * s) * scale.z, (y * z * t - x * s) * scale.z, (z * z * t + c)     * scale.z,
+        translation.x, translation.y, translation.z,
+    }};
+}
+
+/* a * b, applies b then a, like mat4_mul. */
+static inline affine_t affine_mul(affine_t a, affine_t b)
+{
+    const float *m1 = a.data;
+    const float *m2 = b.data;
+
+    affine_t res;
+
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 3; i++) {
+            res.data[j * 3 + i] = m1[i] * m2[j * 3] + m1[3 + i] * m2[j * 3 + 1] + m1[6 + i] * m2[j * 3 + 2];
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        res.data[9 + i] += m1[9 + i];
+    }
+
+    return res;
+}
+
+/* Returns whether the linear part maps each axis onto a single axis, a
+ * permutation with per-axis scales and flips, and which input axis feeds
+ * each output axis. Such transforms can be applied by swizzling.
+ */
+static inline int affine_axes(affine_t a, int axes_o[3])
+{
+    int used = 0;
+
+    for (int i = 0; i < 3; i++) {
+        int axis = -1;
+
+        for (int j = 0; j < 3; j++) {
+            if (a.data[j * 3 + i] == 0.0f)
+                continue;
+
+            if (axis != -1)
+                return 0;
+
+            axis = j;
+        }
+
+        if (axis == -1 || (used & (1 << axis)))
+            return 0;
+
+        used |= 1 << axis;
+        axes_o[i] = axis;
+    }
+
+    return 1;
+}
+
+static inline vec3_t affine_point(affine_t a, vec3_t p)
+{
+    const float *m = a.data;
+
+    return (vec3_t) {
+        .x = m[0] * p.x + m[3] * p.y + m[6] * p.z + m[9],
+        .y = m[1] * p.x + m[4] * p.y + m[7] * p.z + m[10],
+        .z = m[2] * p.x + m[5] * p.y + m[8] * p.z + m[11],
+    };
+}
+
+static inline vec3_t affine_vector(affine_t a, vec3_t v)
+{
+    const float *m = a.data;
+
+    return (vec3_t) {
+        .x = m[0] * v.x + m[3] * v.y + m[6] * v.z,
+        .y = m[1] * v.x + m[4] * v.y + m[7] * v.z,
+        .z = m[2] * v.x + m[5] * v.y + m[8] * v.z,
+    };
+}
+
+/* Inverse transpose of the linear part, no translation. Its columns are the
+ * cross products of the other two columns over the determinant, for a
+ * rotation times a scale that's the rotation times the inverse scale. A
+ * singular linear part is returned as is.
+ */
+static inline affine_t affine_normal(affine_t a)
+{
+    vec3_t c0 = { .x = a.data[0], .y = a.data[1], .z = a.data[2] };
+    vec3_t c1 = { .x = a.data[3], .y = a.data[4], .z = a.data[5] };
+    vec3_t c2 = { .x = a.data[6], .y = a.data[7], .z = a.data[8] };
+
+    vec3_t n0 = vec3_cross(c1, c2);
+    vec3_t n1 = vec3_cross(c2, c0);
+    vec3_t n2 = vec3_cross(c0, c1);
+
+    float det = vec3_dot(c0, n0);
+
+    if (det == 0.0f) {
+        a.data[9] = a.data[10] = a.data[11] = 0.0f;
+        return a;
+    }
+
+    float inv_det = 1.0f / det;
+
+    return (affine_t) {{
+        n0.x * inv_det, n0.y * inv_det, n0.z * inv_det,
+        n1.x * inv_det, n1.y * inv_det, n1.z * inv_det,
+        n2.x * inv_det, n2.y * inv_det, n2.z * inv_det,
+        0.0f, 0.0f, 0.0f,
+    }};
+}
+
+/* The inverse's linear part is the transpose of affine_normal's. */
+static inline affine_t affine_inverse(affine_t a)
+{
+    affine_t n = affine_normal(a);
+
+    affine_t res = {{
+        n.data[0], n.data[3], n.data[6],
+        n.data[1], n.data[4], n.data[7],
+        n.data[2], n.data[5], n.data[8],
+        0.0f, 0.0f, 0.0f,
+    }};
+
+    vec3_t t = affine_vector(res, (vec3_t) { .x = a.data[9], .y = a.data[10], .z = a.data[11] });
+
+    res.data[9]  = -t.x;
+    res.data[10] = -t.y;
+    res.data[11] = -t.z;
+
+    return res;
+}
+
+static inline mat4_t affine_to_mat4(affine_t a)
+{
+    const float *m = a.data;
+
+    return (mat4_t) {{
+        m[0], m[1],  m[2],  0.0f,
+        m[3], m[4],  m[5],  0.0f,
+        m[6], m[7],  m[8],  0.0f,
+        m[9], m[10], m[11], 1.0f,
+    }};
+}
+
+/* Drops the last row, which has to be (0 0 0 1) for the result to mean
+ * anything.
+ */
+static inline affine_t affine_from_mat4(mat4_t m)
+{
+    const float *d = m.data;
+
+    return (affine_t) {{
+        d[0],  d[1],  d[2],
+        d[4],  d[5],  d[6],
+        d[8],  d[9],  d[10],
+        d[12], d[13], d[14],
+    }};
+}
+
+
 typedef struct
 {
     union {
@@ -392,14 +814,554 @@ typedef struct {
 } ivec4_t;
 
 
-// TODO: Remove and create a custom random number gen.
-#include <stdint.h>
-#include <stdlib.h>
-static inline float lina_rand_norm(void)
+/* Batches of vectors as structure of arrays, one array per component. The
+ * loops are kept plain so compilers vectorize them, SIMD versions are only
+ * written where that doesn't happen on its own. `out` may be one of the
+ * inputs.
+ */
+typedef struct
+{
+    float *x;
+    float *y;
+    float *z;
+} vec3_soa_t;
+
+static inline void affine_points_soa(affine_t a, vec3_soa_t in, vec3_soa_t out, size_t count)
+{
+    const float *m = a.data;
+
+    for (size_t i = 0; i < count; i++) {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+
+        out.x[i] = m[0] * x + m[3] * y + m[6] * z + m[9];
+        out.y[i] = m[1] * x + m[4] * y + m[7] * z + m[10];
+        out.z[i] = m[2] * x + m[5] * y + m[8] * z + m[11];
+    }
+}
+
+/* Directions, pass affine_normal(a) for normals. */
+static inline void affine_vectors_soa(affine_t a, vec3_soa_t in, vec3_soa_t out, size_t count)
+{
+    const float *m = a.data;
+
+    for (size_t i = 0; i < count; i++) {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+
+        out.x[i] = m[0] * x + m[3] * y + m[6] * z;
+        out.y[i] = m[1] * x + m[4] * y + m[7] * z;
+        out.z[i] = m[2] * x + m[5] * y + m[8] * z;
+    }
+}
+
+static inline void vec3_dot_soa(vec3_soa_t a, vec3_soa_t b, float *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a.x[i] * b.x[i] + a.y[i] * b.y[i] + a.z[i] * b.z[i];
+    }
+}
+
+static inline void vec3_cross_soa(vec3_soa_t a, vec3_soa_t b, vec3_soa_t out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        float ax = a.x[i], ay = a.y[i], az = a.z[i];
+        float bx = b.x[i], by = b.y[i], bz = b.z[i];
+
+        out.x[i] = ay * bz - az * by;
+        out.y[i] = az * bx - ax * bz;
+        out.z[i] = ax * by - ay * bx;
+    }
+}
+
+/* Zero vectors come out as NaN, like vec3_normalize. sqrtf keeps compilers
+ * from vectorizing this one (errno), hence the explicit versions.
+ */
+static inline void vec3_normalize_soa(vec3_soa_t in, vec3_soa_t out, size_t count)
+{
+    size_t i = 0;
+
+#if defined(LINA_AVX)
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+
+        __m256 length_sq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        __m256 inv_length = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(length_sq));
+
+        _mm256_storeu_ps(out.x + i, _mm256_mul_ps(x, inv_length));
+        _mm256_storeu_ps(out.y + i, _mm256_mul_ps(y, inv_length));
+        _mm256_storeu_ps(out.z + i, _mm256_mul_ps(z, inv_length));
+    }
+#elif defined(LINA_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+
+        __m128 length_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        __m128 inv_length = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length_sq));
+
+        _mm_storeu_ps(out.x + i, _mm_mul_ps(x, inv_length));
+        _mm_storeu_ps(out.y + i, _mm_mul_ps(y, inv_length));
+        _mm_storeu_ps(out.z + i, _mm_mul_ps(z, inv_length));
+    }
+#endif
+
+    for (size_t j = 0; i + j < count; j++) {
+        size_t k = i + j;
+
+        float x = in.x[k], y = in.y[k], z = in.z[k];
+        float inv_length = 1.0f / sqrtf(x * x + y * y + z * z);
+
+        out.x[k] = x * inv_length;
+        out.y[k] = y * inv_length;
+        out.z[k] = z * inv_length;
+    }
+}
+
+/* Written as compares so they match minps/maxps with the new value first:
+ * NaNs in `b` are skipped.
+ */
+static inline float lina__min(float a, float b) { return b < a ? b : a; }
+static inline float lina__max(float a, float b) { return b > a ? b : a; }
+
+/* Folds `count` floats into min[k % 3] and max[k % 3], for reducing SIMD
+ * lanes that hold components in rotation.
+ */
+static inline void lina__aabb_lanes(const float *lanes_min, const float *lanes_max, int count,
+                                    float min[3], float max[3])
 {
-    return rand() / (float)RAND_MAX;
+    for (int k = 0; k < count; k++) {
+        min[k % 3] = lina__min(min[k % 3], lanes_min[k]);
+        max[k % 3] = lina__max(max[k % 3], lanes_max[k]);
+    }
 }
 
+/* Bounds of `count` vectors, count has to be at least 1. Compilers don't
+ * vectorize min/max reductions without -ffast-math, so they're spelled out.
+ */
+static inline void vec3_aabb_soa(vec3_soa_t v, size_t count, vec3_t *min_o, vec3_t *max_o)
+{
+    float min[3] = { v.x[0], v.y[0], v.z[0] };
+    float max[3] = { v.x[0], v.y[0], v.z[0] };
+
+    size_t i = 1;
+
+#if defined(LINA_SSE2)
+    if (count >= 4) {
+        const float *arrays[3] = { v.x, v.y, v.z };
+
+        for (int k = 0; k < 3; k++) {
+            const float *a = arrays[k];
+            size_t j = 0;
+
+#if defined(LINA_AVX)
+            __m256 min8 = _mm256_set1_ps(a[0]);
+            __m256 max8 = min8;
+
+            for (; j + 8 <= count; j += 8) {
+                __m256 x = _mm256_loadu_ps(a + j);
+                min8 = _mm256_min_ps(x, min8);
+                max8 = _mm256_max_ps(x, max8);
+            }
+
+            __m128 min4 = _mm_min_ps(_mm256_castps256_ps128(min8), _mm256_extractf128_ps(min8, 1));
+            __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(max8), _mm256_extractf128_ps(max8, 1));
+#else
+            __m128 min4 = _mm_set1_ps(a[0]);
+            __m128 max4 = min4;
+#endif
+
+            for (; j + 4 <= count; j += 4) {
+                __m128 x = _mm_loadu_ps(a + j);
+                min4 = _mm_min_ps(x, min4);
+                max4 = _mm_max_ps(x, max4);
+            }
+
+            float lanes_min[4], lanes_max[4];
+            _mm_storeu_ps(lanes_min, min4);
+            _mm_storeu_ps(lanes_max, max4);
+
+            for (int l = 0; l < 4; l++) {
+                min[k] = lina__min(min[k], lanes_min[l]);
+                max[k] = lina__max(max[k], lanes_max[l]);
+            }
+
+            i = j;
+        }
+    }
+#endif
+
+    for (size_t j = 0; i + j < count; j++) {
+        size_t k = i + j;
+
+        min[0] = lina__min(min[0], v.x[k]);
+        min[1] = lina__min(min[1], v.y[k]);
+        min[2] = lina__min(min[2], v.z[k]);
+
+        max[0] = lina__max(max[0], v.x[k]);
+        max[1] = lina__max(max[1], v.y[k]);
+        max[2] = lina__max(max[2], v.z[k]);
+    }
+
+    *min_o = (vec3_t) { .x = min[0], .y = min[1], .z = min[2] };
+    *max_o = (vec3_t) { .x = max[0], .y = max[1], .z = max[2] };
+}
+
+/* Bounds of `count` packed xyz triples, the layout meshes are kept in, count
+ * has to be at least 1. A few vectors fill three registers whose lanes hold
+ * the components in a fixed rotation, they're reduced lane by lane and sorted
+ * out at the end.
+ */
+static inline void vec3_aabb(const float *xyz, size_t count, vec3_t *min_o, vec3_t *max_o)
+{
+    float min[3] = { xyz[0], xyz[1], xyz[2] };
+    float max[3] = { xyz[0], xyz[1], xyz[2] };
+
+    const float *p   = xyz;
+    const float *end = xyz + count * 3;
+
+#if defined(LINA_AVX)
+    if (end - p >= 24) {
+        __m256 min0 = _mm256_loadu_ps(p),      max0 = min0;
+        __m256 min1 = _mm256_loadu_ps(p + 8),  max1 = min1;
+        __m256 min2 = _mm256_loadu_ps(p + 16), max2 = min2;
+
+        for (p += 24; end - p >= 24; p += 24) {
+            __m256 a = _mm256_loadu_ps(p);
+            __m256 b = _mm256_loadu_ps(p + 8);
+            __m256 c = _mm256_loadu_ps(p + 16);
+
+            min0 = _mm256_min_ps(a, min0);
+            min1 = _mm256_min_ps(b, min1);
+            min2 = _mm256_min_ps(c, min2);
+
+            max0 = _mm256_max_ps(a, max0);
+            max1 = _mm256_max_ps(b, max1);
+            max2 = _mm256_max_ps(c, max2);
+        }
+
+        float lanes_min[24], lanes_max[24];
+
+        _mm256_storeu_ps(lanes_min,      min0);
+        _mm256_storeu_ps(lanes_min + 8,  min1);
+        _mm256_storeu_ps(lanes_min + 16, min2);
+
+        _mm256_storeu_ps(lanes_max,      max0);
+        _mm256_storeu_ps(lanes_max + 8,  max1);
+        _mm256_storeu_ps(lanes_max + 16, max2);
+
+        lina__aabb_lanes(lanes_min, lanes_max, 24, min, max);
+    }
+#elif defined(LINA_SSE2)
+    if (end - p >= 12) {
+        __m128 min0 = _mm_loadu_ps(p),     max0 = min0;
+        __m128 min1 = _mm_loadu_ps(p + 4), max1 = min1;
+        __m128 min2 = _mm_loadu_ps(p + 8), max2 = min2;
+
+        for (p += 12; end - p >= 12; p += 12) {
+            __m128 a = _mm_loadu_ps(p);
+            __m128 b = _mm_loadu_ps(p + 4);
+            __m128 c = _mm_loadu_ps(p + 8);
+
+            min0 = _mm_min_ps(a, min0);
+            min1 = _mm_min_ps(b, min1);
+            min2 = _mm_min_ps(c, min2);
+
+            max0 = _mm_max_ps(a, max0);
+            max1 = _mm_max_ps(b, max1);
+            max2 = _mm_max_ps(c, max2);
+        }
+
+        float lanes_min[12], lanes_max[12];
+
+        _mm_storeu_ps(lanes_min,     min0);
+        _mm_storeu_ps(lanes_min + 4, min1);
+        _mm_storeu_ps(lanes_min + 8, min2);
+
+        _mm_storeu_ps(lanes_max,     max0);
+        _mm_storeu_ps(lanes_max + 4, max1);
+        _mm_storeu_ps(lanes_max + 8, max2);
+
+        lina__aabb_lanes(lanes_min, lanes_max, 12, min, max);
+    }
+#endif
+
+    for (; p < end; p += 3) {
+        lina__aabb_lanes(p, p, 3, min, max);
+    }
+
+    *min_o = (vec3_t) { .x = min[0], .y = min[1], .z = min[2] };
+    *max_o = (vec3_t) { .x = max[0], .y = max[1], .z = max[2] };
+}
+
+
+/* xoshiro256** by David Blackman and Sebastiano Vigna, https://prng.di.unimi.it/
+ *
+ * The state is explicit, give every thread or worker its own: seed them from
+ * one seed and `lina_rng_jump` each one 2^128 steps further than the last to
+ * get non-overlapping streams. The same seed gives the same numbers on every
+ * target, with or without SIMD.
+ */
+typedef struct
+{
+    uint64_t s[4];
+} lina_rng_t;
+
+/* Lanes of `lina_rng_fill`, stepped side by side. */
+#define LINA_RNG_LANES 4
+
+static inline uint64_t lina__rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t lina__splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+/* Spreads `seed` over the state through splitmix64, as recommended, so
+ * close seeds give unrelated streams.
+ */
+static inline lina_rng_t lina_rng_seed(uint64_t seed)
+{
+    lina_rng_t rng;
+
+    for (int i = 0; i < 4; i++) {
+        rng.s[i] = lina__splitmix64(&seed);
+    }
+
+    return rng;
+}
+
+static inline uint64_t lina_rng_next(lina_rng_t *rng)
+{
+    uint64_t *s = rng->s;
+
+    uint64_t result = lina__rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+
+    s[2] ^= t;
+
+    s[3] = lina__rotl(s[3], 45);
+
+    return result;
+}
+
+/* Advances the state by 2^128 steps. */
+static inline void lina_rng_jump(lina_rng_t *rng)
+{
+    static const uint64_t jump[4] = {
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c,
+    };
+
+    uint64_t s[4] = {0};
+
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & ((uint64_t)1 << b)) {
+                s[0] ^= rng->s[0];
+                s[1] ^= rng->s[1];
+                s[2] ^= rng->s[2];
+                s[3] ^= rng->s[3];
+            }
+
+            lina_rng_next(rng);
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = s[i];
+    }
+}
+
+/* Uniform in [0, 1), from the top 24 bits. */
+static inline float lina_rng_float(lina_rng_t *rng)
+{
+    return (float)(lina_rng_next(rng) >> 40) * 0x1.0p-24f;
+}
+
+/* `lina_rng_fill` state, word i of lane j in s[i][j], so a register holds the
+ * same word of neighbouring lanes.
+ */
+typedef struct
+{
+    _Alignas(32) uint64_t s[4][LINA_RNG_LANES];
+} lina_rng_lanes_t;
+
+static inline float lina__rng_lane_float(lina_rng_lanes_t *lanes, int j)
+{
+    lina_rng_t rng = {{ lanes->s[0][j], lanes->s[1][j], lanes->s[2][j], lanes->s[3][j] }};
+
+    float f = lina_rng_float(&rng);
+
+    for (int i = 0; i < 4; i++) {
+        lanes->s[i][j] = rng.s[i];
+    }
+
+    return f;
+}
+
+/* Fills `out` with `count` uniform floats in [0, 1). Fills of at least
+ * 4 * LINA_RNG_LANES floats seed that many lanes from `rng` and interleave
+ * them, out[i] coming from lane i % LINA_RNG_LANES, which SIMD steps at once.
+ * Either way `rng` advances by a fixed amount that only depends on `count`.
+ */
+static inline void lina_rng_fill(lina_rng_t *rng, float *out, size_t count)
+{
+    if (count < 4 * LINA_RNG_LANES) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = lina_rng_float(rng);
+        }
+
+        return;
+    }
+
+    lina_rng_lanes_t lanes;
+
+    for (int j = 0; j < LINA_RNG_LANES; j++) {
+        lina_rng_t lane = lina_rng_seed(lina_rng_next(rng));
+
+        for (int i = 0; i < 4; i++) {
+            lanes.s[i][j] = lane.s[i];
+        }
+    }
+
+    size_t i = 0;
+
+#if defined(LINA_AVX2)
+    __m256i s0 = _mm256_load_si256((const __m256i *)lanes.s[0]);
+    __m256i s1 = _mm256_load_si256((const __m256i *)lanes.s[1]);
+    __m256i s2 = _mm256_load_si256((const __m256i *)lanes.s[2]);
+    __m256i s3 = _mm256_load_si256((const __m256i *)lanes.s[3]);
+
+    const __m256i low_words = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m128  unit      = _mm_set1_ps(0x1.0p-24f);
+
+    for (; i + LINA_RNG_LANES <= count; i += LINA_RNG_LANES) {
+        // rotl(s1 * 5, 7) * 9, multiplies as shifts and adds
+        __m256i x = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+        x = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+        x = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);
+
+        __m256i t = _mm256_slli_epi64(s1, 17);
+
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+
+        // top 24 bits of each lane, packed into four 32-bit ints
+        x = _mm256_permutevar8x32_epi32(_mm256_srli_epi64(x, 40), low_words);
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm256_castsi256_si128(x)), unit));
+    }
+
+    _mm256_store_si256((__m256i *)lanes.s[0], s0);
+    _mm256_store_si256((__m256i *)lanes.s[1], s1);
+    _mm256_store_si256((__m256i *)lanes.s[2], s2);
+    _mm256_store_si256((__m256i *)lanes.s[3], s3);
+#elif defined(LINA_SSE2)
+    // lanes 0-1 in the a registers, 2-3 in the b ones
+    __m128i a0 = _mm_load_si128((const __m128i *)lanes.s[0]);
+    __m128i a1 = _mm_load_si128((const __m128i *)lanes.s[1]);
+    __m128i a2 = _mm_load_si128((const __m128i *)lanes.s[2]);
+    __m128i a3 = _mm_load_si128((const __m128i *)lanes.s[3]);
+
+    __m128i b0 = _mm_load_si128((const __m128i *)lanes.s[0] + 1);
+    __m128i b1 = _mm_load_si128((const __m128i *)lanes.s[1] + 1);
+    __m128i b2 = _mm_load_si128((const __m128i *)lanes.s[2] + 1);
+    __m128i b3 = _mm_load_si128((const __m128i *)lanes.s[3] + 1);
+
+    const __m128 unit = _mm_set1_ps(0x1.0p-24f);
+
+#define LINA_RNG_STEP(x, s0, s1, s2, s3) do {                                 \
+        x = _mm_add_epi64(_mm_slli_epi64(s1, 2), s1);                         \
+        x = _mm_or_si128(_mm_slli_epi64(x, 7), _mm_srli_epi64(x, 57));        \
+        x = _mm_add_epi64(_mm_slli_epi64(x, 3), x);                           \
+        __m128i t = _mm_slli_epi64(s1, 17);                                   \
+        s2 = _mm_xor_si128(s2, s0);                                           \
+        s3 = _mm_xor_si128(s3, s1);                                           \
+        s1 = _mm_xor_si128(s1, s2);                                           \
+        s0 = _mm_xor_si128(s0, s3);                                           \
+        s2 = _mm_xor_si128(s2, t);                                            \
+        s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));    \
+        x = _mm_srli_epi64(x, 40);                                            \
+    } while (0)
+
+    for (; i + LINA_RNG_LANES <= count; i += LINA_RNG_LANES) {
+        __m128i xa, xb;
+
+        LINA_RNG_STEP(xa, a0, a1, a2, a3);
+        LINA_RNG_STEP(xb, b0, b1, b2, b3);
+
+        // low 32 bits of the four lanes
+        __m128 x = _mm_shuffle_ps(_mm_castsi128_ps(xa), _mm_castsi128_ps(xb), _MM_SHUFFLE(2, 0, 2, 0));
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(x)), unit));
+    }
+
+#undef LINA_RNG_STEP
+
+    _mm_store_si128((__m128i *)lanes.s[0], a0);
+    _mm_store_si128((__m128i *)lanes.s[1], a1);
+    _mm_store_si128((__m128i *)lanes.s[2], a2);
+    _mm_store_si128((__m128i *)lanes.s[3], a3);
+
+    _mm_store_si128((__m128i *)lanes.s[0] + 1, b0);
+    _mm_store_si128((__m128i *)lanes.s[1] + 1, b1);
+    _mm_store_si128((__m128i *)lanes.s[2] + 1, b2);
+    _mm_store_si128((__m128i *)lanes.s[3] + 1, b3);
+
+#else
+    for (; i + LINA_RNG_LANES <= count; i += LINA_RNG_LANES) {
+        for (int j = 0; j < LINA_RNG_LANES; j++) {
+            out[i + j] = lina__rng_lane_float(&lanes, j);
+        }
+    }
+#endif
+
+    for (int j = 0; i + j < count; j++) {
+        out[i + j] = lina__rng_lane_float(&lanes, j);
+    }
+}
+
+#ifndef LINA_RAND_SEED
+    #define LINA_RAND_SEED 0x6c696e61 /* "lina" */
+#endif
+
+/* Per thread state behind lina_rand_norm, every thread starts from
+ * LINA_RAND_SEED. Keep a lina_rng_t per worker for independent streams.
+ */
+static _Thread_local lina_rng_t lina__rand_state;
+static _Thread_local int        lina__rand_seeded;
+
+static inline void lina_rand_seed(uint64_t seed)
+{
+    lina__rand_state  = lina_rng_seed(seed);
+    lina__rand_seeded = 1;
+}
+
+/* Uniform in [0, 1) from the calling thread's state. */
+static inline float lina_rand_norm(void)
+{
+    if (!lina__rand_seeded) {
+        lina_rand_seed(LINA_RAND_SEED);
+    }
+
+    return lina_rng_float(&lina__rand_state);
+}
 
 
 #endif // LINA_H_
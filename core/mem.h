@@ -0,0 +1,314 @@
+#ifndef MEM_H_
+#define MEM_H_
+
+/* Allocation tracking.
+ *
+ * With MEM_TRACK, on by default in _DEBUG builds, every allocation made
+ * through mem_* carries a header with its size and tag. Per tag counters keep
+ * the allocations, reallocs and frees, the bytes reallocs had to move, the
+ * live bytes and their peak. Without it the functions are malloc, calloc,
+ * realloc and free. Memory from mem_* has to go back through mem_free.
+ *
+ * Containers that grow deep inside some phase (dck.h) take the calling
+ * thread's current tag, set with mem_tag_set around the phase. A block keeps
+ * the tag it was allocated with when it's reallocated.
+ *
+ * Between mem_forbid_begin and mem_forbid_end, e.g. around the draw calls of
+ * a frame, any tracked allocation on that thread aborts.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(MEM_TRACK)
+    #if defined(_DEBUG)
+        #define MEM_TRACK 1
+    #else
+        #define MEM_TRACK 0
+    #endif
+#endif
+
+typedef enum
+{
+    mem_Other,
+    mem_Mesh,
+    mem_Io,
+    mem_Cache,
+} mem_tag_t;
+
+#define MEM_TAG_COUNT (mem_Cache + 1)
+
+typedef struct
+{
+    size_t allocs;
+    size_t reallocs;
+    size_t frees;
+    size_t copied; // bytes moved by reallocs that changed the address
+    size_t live;
+    size_t peak;
+} mem_stats_t;
+
+const char *mem_tag_name(mem_tag_t tag);
+
+/* Counters of `tag`, MEM_TAG_COUNT sums all tags, its peak is that of the
+ * sum. All zero without MEM_TRACK.
+ */
+mem_stats_t mem_stats(mem_tag_t tag);
+
+/* Prints the counters of every tag. */
+void mem_report(FILE *file);
+
+#if MEM_TRACK
+
+void *mem_alloc(mem_tag_t tag, size_t size);
+void *mem_calloc(mem_tag_t tag, size_t count, size_t size);
+
+/* A NULL `ptr` allocates with `tag`, otherwise the block keeps its own. */
+void *mem_realloc(mem_tag_t tag, void *ptr, size_t size);
+
+void mem_free(void *ptr);
+
+mem_tag_t mem_tag(void);
+
+/* Sets the calling thread's current tag, returns the previous one. */
+mem_tag_t mem_tag_set(mem_tag_t tag);
+
+void mem_forbid_begin(void);
+void mem_forbid_end(void);
+
+#else
+
+#define mem_alloc(tag, size)         ((void)(tag), malloc(size))
+#define mem_calloc(tag, count, size) ((void)(tag), calloc(count, size))
+#define mem_realloc(tag, ptr, size)  ((void)(tag), realloc(ptr, size))
+#define mem_free(ptr)                free(ptr)
+
+static inline mem_tag_t mem_tag(void) { return mem_Other; }
+static inline mem_tag_t mem_tag_set(mem_tag_t tag) { (void)tag; return mem_Other; }
+
+static inline void mem_forbid_begin(void) { }
+static inline void mem_forbid_end(void) { }
+
+#endif
+
+
+#if defined(MEM_IMPLEMENTATION)
+
+const char *mem_tag_name(mem_tag_t tag)
+{
+    static const char *names[MEM_TAG_COUNT] = { "other", "mesh", "io", "cache" };
+    return tag < MEM_TAG_COUNT ? names[tag] : "total";
+}
+
+#if MEM_TRACK
+
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct
+{
+    _Alignas(max_align_t) size_t size;
+    mem_tag_t tag;
+} mem__header_t;
+
+typedef struct
+{
+    atomic_size_t allocs;
+    atomic_size_t reallocs;
+    atomic_size_t frees;
+    atomic_size_t copied;
+    atomic_size_t live;
+    atomic_size_t peak;
+} mem__counters_t;
+
+// the last one counts all tags
+static mem__counters_t mem__counters[MEM_TAG_COUNT + 1];
+
+static _Thread_local mem_tag_t mem__tag;
+static _Thread_local int       mem__forbidden;
+
+static void mem__grow(mem__counters_t *counters, size_t size)
+{
+    size_t live = atomic_fetch_add(&counters->live, size) + size;
+    size_t peak = atomic_load(&counters->peak);
+
+    while (live > peak && !atomic_compare_exchange_weak(&counters->peak, &peak, live)) { }
+}
+
+static void mem__account(mem_tag_t tag, size_t grown, size_t shrunk)
+{
+    mem__counters_t *counters[2] = { mem__counters + tag, mem__counters + MEM_TAG_COUNT };
+
+    for (int i = 0; i < 2; ++i) {
+        if (grown) {
+            mem__grow(counters[i], grown);
+        }
+
+        if (shrunk) {
+            atomic_fetch_sub(&counters[i]->live, shrunk);
+        }
+    }
+}
+
+static void mem__check(mem_tag_t tag, size_t size)
+{
+    if (mem__forbidden) {
+        fprintf(stderr, "mem: %zu byte %s allocation while allocations are forbidden\n",
+                size, mem_tag_name(tag));
+        abort();
+    }
+}
+
+void *mem_alloc(mem_tag_t tag, size_t size)
+{
+    mem__check(tag, size);
+
+    if (size > SIZE_MAX - sizeof(mem__header_t))
+        return NULL;
+
+    mem__header_t *header = malloc(sizeof(*header) + size);
+    if (!header)
+        return NULL;
+
+    *header = (mem__header_t) { .size = size, .tag = tag };
+
+    atomic_fetch_add(&mem__counters[tag].allocs, 1);
+    atomic_fetch_add(&mem__counters[MEM_TAG_COUNT].allocs, 1);
+    mem__account(tag, size, 0);
+
+    return header + 1;
+}
+
+void *mem_calloc(mem_tag_t tag, size_t count, size_t size)
+{
+    if (size && count > (SIZE_MAX - sizeof(mem__header_t)) / size)
+        return NULL;
+
+    void *ptr = mem_alloc(tag, count * size);
+
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+void *mem_realloc(mem_tag_t tag, void *ptr, size_t size)
+{
+    if (!ptr)
+        return mem_alloc(tag, size);
+
+    mem__header_t *old = (mem__header_t *)ptr - 1;
+    mem__header_t  was = *old;
+
+    mem__check(was.tag, size);
+
+    if (size > SIZE_MAX - sizeof(mem__header_t))
+        return NULL;
+
+    mem__header_t *header = realloc(old, sizeof(*header) + size);
+    if (!header)
+        return NULL;
+
+    header->size = size;
+
+    atomic_fetch_add(&mem__counters[was.tag].reallocs, 1);
+    atomic_fetch_add(&mem__counters[MEM_TAG_COUNT].reallocs, 1);
+
+    if (header != old) {
+        size_t moved = was.size < size ? was.size : size;
+
+        atomic_fetch_add(&mem__counters[was.tag].copied, moved);
+        atomic_fetch_add(&mem__counters[MEM_TAG_COUNT].copied, moved);
+    }
+
+    mem__account(was.tag, size > was.size ? size - was.size : 0,
+                          size < was.size ? was.size - size : 0);
+
+    return header + 1;
+}
+
+void mem_free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    mem__header_t *header = (mem__header_t *)ptr - 1;
+
+    atomic_fetch_add(&mem__counters[header->tag].frees, 1);
+    atomic_fetch_add(&mem__counters[MEM_TAG_COUNT].frees, 1);
+    mem__account(header->tag, 0, header->size);
+
+    free(header);
+}
+
+mem_tag_t mem_tag(void)
+{
+    return mem__tag;
+}
+
+mem_tag_t mem_tag_set(mem_tag_t tag)
+{
+    mem_tag_t previous = mem__tag;
+    mem__tag = tag;
+    return previous;
+}
+
+void mem_forbid_begin(void)
+{
+    ++mem__forbidden;
+}
+
+void mem_forbid_end(void)
+{
+    --mem__forbidden;
+}
+
+mem_stats_t mem_stats(mem_tag_t tag)
+{
+    mem__counters_t *counters = mem__counters + (tag < MEM_TAG_COUNT ? tag : MEM_TAG_COUNT);
+
+    return (mem_stats_t) {
+        .allocs   = atomic_load(&counters->allocs),
+        .reallocs = atomic_load(&counters->reallocs),
+        .frees    = atomic_load(&counters->frees),
+        .copied   = atomic_load(&counters->copied),
+        .live     = atomic_load(&counters->live),
+        .peak     = atomic_load(&counters->peak),
+    };
+}
+
+void mem_report(FILE *file)
+{
+    fprintf(file, "%-6s %10s %10s %10s %12s %12s %12s\n",
+            "memory", "allocs", "reallocs", "frees", "copied", "live", "peak");
+
+    for (int tag = 0; tag <= MEM_TAG_COUNT; ++tag) {
+        mem_stats_t stats = mem_stats(tag);
+
+        fprintf(file, "%-6s %10zu %10zu %10zu %12zu %12zu %12zu\n", mem_tag_name(tag),
+                stats.allocs, stats.reallocs, stats.frees, stats.copied, stats.live, stats.peak);
+    }
+}
+
+#else
+
+mem_stats_t mem_stats(mem_tag_t tag)
+{
+    (void)tag;
+    return (mem_stats_t) {0};
+}
+
+void mem_report(FILE *file)
+{
+    fprintf(file, "memory: not tracked, build with MEM_TRACK\n");
+}
+
+#endif // MEM_TRACK
+
+#endif // defined(MEM_IMPLEMENTATION)
+
+
+#endif // MEM_H_
@@ -1,12 +1,55 @@
 #ifndef PARSE_H_
 #define PARSE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
 int
 parse_simple_int(const char *begin, const char *end, char **restrict next_o);
 
+/* Parses `[+-]digits` after skipping whitespace, eight digits at a time.
+ * Saturates at INT_MIN/INT_MAX. On failure `*next_o` is set to NULL.
+ */
+int
+parse_int(const char *begin, const char *end, char **restrict next_o);
+
+/* Wavefront OBJ face vertex, 0 marks a missing component. Negative
+ * (relative) indices are kept as they are for the caller to resolve.
+ */
+typedef struct
+{
+    int v, vt, vn;
+} parse_triplet_t;
+
+/* Parses `v`, `v/vt`, `v//vn` or `v/vt/vn` after skipping whitespace.
+ * Returns 0 and sets `*next_o` to NULL when there's no vertex index.
+ */
+int
+parse_index_triplet(const char *begin, const char *end, parse_triplet_t *triplet_o,
+                    char **restrict next_o);
+
+/* Same as `parse_float`, kept for older callers. */
 float
 parse_simple_float(const char *begin, const char *end, char **restrict next_o);
 
+/* Parses `[+-]digits[.digits][(e|E)[+-]digits]` after skipping whitespace,
+ * correctly rounded to the nearest float. On failure `*next_o` is set to NULL.
+ *
+ * Uses the Clinger fast path for short exact inputs, Eisel-Lemire for the
+ * rest, and falls back to strtof only when more than 19 significant digits
+ * leave the result ambiguous. The slow path honors the current locale.
+ */
+float
+parse_float(const char *begin, const char *end, char **restrict next_o);
+
+/* Parses up to `count` whitespace separated floats into `out`.
+ * Returns how many were parsed, `*next_o` points right after the last one.
+ */
+size_t
+parse_floats_n(const char *begin, const char *end, float *restrict out, size_t count,
+               char **restrict next_o);
+
 
 static inline int
 is_space(char c)
@@ -20,9 +63,75 @@ is_digit(char c)
     return c >= '0' && c <= '9';
 }
 
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    #define PARSE_SWAR 1
+#else
+    #define PARSE_SWAR 0
+#endif
+
+static inline uint64_t
+parse_load8(const char *at)
+{
+    uint64_t value;
+    memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+/* All eight bytes are '0'...'9'. */
+static inline int
+parse_is_eight_digits(uint64_t value)
+{
+    return !(((value + 0x4646464646464646ull) | (value - 0x3030303030303030ull))
+             & 0x8080808080808080ull);
+}
+
+/* Number of leading '0'...'9' bytes out of eight loaded little endian. */
+static inline int
+parse_digit_count8(uint64_t value)
+{
+    uint64_t non_digit = ((value + 0x4646464646464646ull) | (value - 0x3030303030303030ull))
+                       & 0x8080808080808080ull;
+
+    if (!non_digit)
+        return 8;
+
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(non_digit) / 8;
+#else
+    int count = 0;
+    while (!(non_digit & 0x80)) {
+        non_digit >>= 8;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/* Value of eight ASCII digits loaded little endian, first digit lowest. */
+static inline uint32_t
+parse_eight_digits(uint64_t value)
+{
+    const uint64_t mask = 0x000000ff000000ffull;
+    const uint64_t mul1 = 0x000f424000000064ull; // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+
+    value -= 0x3030303030303030ull;
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+
+    return (uint32_t)value;
+}
+
 
 #if defined(PARSE_IMPLEMENTATION)
 
+#include <stdlib.h>
+#include <limits.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
 
 int
 parse_simple_int(const char *begin, const char *end, char **restrict next_o)
@@ -64,6 +173,76 @@ parse_simple_int(const char *begin, const char *end, char **restrict next_o)
 
 float
 parse_simple_float(const char *begin, const char *end, char **restrict next_o)
+{
+    return parse_float(begin, end, next_o);
+}
+
+/* Consumes the digits at `*at_io`, saturating at UINT64_MAX.
+ * Returns the number of digits consumed.
+ */
+static inline size_t
+parse_digits_u64(const char **at_io, const char *end, uint64_t *value_o)
+{
+    const char *begin = *at_io;
+    const char *at    = begin;
+
+    while (at != end && *at == '0') {
+        ++at;
+    }
+
+    uint64_t value = 0;
+    int count = 0; // significant digits in `value`
+
+#if PARSE_SWAR
+    static const uint64_t pow10[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    };
+
+    while (end - at >= 8 && count + 8 <= 19) {
+        uint64_t chunk = parse_load8(at);
+        int n = parse_digit_count8(chunk);
+
+        if (n == 8) {
+            value = value * 100000000 + parse_eight_digits(chunk);
+            count += 8;
+            at    += 8;
+            continue;
+        }
+
+        if (n) {
+            // left pad the n digits with '0's and convert all eight at once
+            chunk = (chunk << (8 * (8 - n))) | (0x3030303030303030ull >> (8 * n));
+
+            uint64_t digits = parse_eight_digits(chunk);
+            value = count ? value * pow10[n] + digits : digits;
+            at += n;
+        }
+
+        *at_io   = at;
+        *value_o = value;
+
+        return at - begin;
+    }
+#endif
+
+    for (; at != end && is_digit(*at); ++at) {
+        if (count < 19) {
+            value = value * 10 + (*at - '0');
+            ++count;
+        }
+        else {
+            value = UINT64_MAX;
+        }
+    }
+
+    *at_io   = at;
+    *value_o = value;
+
+    return at - begin;
+}
+
+int
+parse_int(const char *begin, const char *end, char **restrict next_o)
 {
     const char *at = begin;
 
@@ -71,52 +250,553 @@ parse_simple_float(const char *begin, const char *end, char **restrict next_o)
         ++at;
     }
 
+    int negative = 0;
+
+    if (at != end && (*at == '-' || *at == '+')) {
+        negative = *at == '-';
+        ++at;
+    }
+
+    uint64_t value;
+
     // failed to parse
-    if (at == end) {
+    if (!parse_digits_u64(&at, end, &value)) {
+        *next_o = 0;
+        return 0;
+    }
+
+    *next_o = (char *)at;
+
+    if (negative)
+        return value > (uint64_t)INT_MAX + 1 ? INT_MIN : (int)(0 - value);
+
+    return value > INT_MAX ? INT_MAX : (int)value;
+}
+
+/* One optionally signed component, 0 if there are no digits. */
+static inline int
+parse_triplet_component(const char **at_io, const char *end)
+{
+    const char *at = *at_io;
+    int negative = 0;
+
+    if (at != end && (*at == '-' || *at == '+')) {
+        negative = *at == '-';
+        ++at;
+    }
+
+    uint64_t value;
+
+    if (!parse_digits_u64(&at, end, &value))
+        return 0;
+
+    *at_io = at;
+
+    if (value > INT_MAX) {
+        value = INT_MAX;
+    }
+
+    return negative ? -(int)value : (int)value;
+}
+
+int
+parse_index_triplet(const char *begin, const char *end, parse_triplet_t *triplet_o,
+                    char **restrict next_o)
+{
+    const char *at = begin;
+
+    while (at != end && is_space(*at)) {
+        ++at;
+    }
+
+    parse_triplet_t triplet = {0};
+
+    triplet.v = parse_triplet_component(&at, end);
+
+    // failed to parse
+    if (triplet.v == 0) {
         *next_o = 0;
+        return 0;
+    }
+
+    if (at != end && *at == '/') {
+        ++at;
+        triplet.vt = parse_triplet_component(&at, end);
+
+        if (at != end && *at == '/') {
+            ++at;
+            triplet.vn = parse_triplet_component(&at, end);
+        }
+    }
+
+    *triplet_o = triplet;
+    *next_o = (char *)at;
+
+    return 1;
+}
+
+
+#define PARSE_F32_MANTISSA_BITS     23
+#define PARSE_F32_MIN_EXPONENT      (-127)
+#define PARSE_F32_INFINITE_POWER    0xff
+#define PARSE_F32_MIN_POW10         (-65)
+#define PARSE_F32_MAX_POW10         38
+#define PARSE_F32_MIN_ROUND_EVEN    (-17)
+#define PARSE_F32_MAX_ROUND_EVEN    10
+
+/* 128 bit truncated (rounded up for negative exponents) normalized powers of
+ * five, from 5^PARSE_F32_MIN_POW10 to 5^PARSE_F32_MAX_POW10, high word first.
+ */
+static const uint64_t parse_pow5_128[] = {
+    0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull, // 5^-65
+    0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull, // 5^-64
+    0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull, // 5^-63
+    0x83a3eeeef9153e89ull, 0x1953cf68300424acull, // 5^-62
+    0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull, // 5^-61
+    0xcdb02555653131b6ull, 0x3792f412cb06794dull, // 5^-60
+    0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull, // 5^-59
+    0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull, // 5^-58
+    0xc8de047564d20a8bull, 0xf245825a5a445275ull, // 5^-57
+    0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull, // 5^-56
+    0x9ced737bb6c4183dull, 0x55464dd69685606bull, // 5^-55
+    0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull, // 5^-54
+    0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull, // 5^-53
+    0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull, // 5^-52
+    0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull, // 5^-51
+    0xef73d256a5c0f77cull, 0x963e66858f6d4440ull, // 5^-50
+    0x95a8637627989aadull, 0xdde7001379a44aa8ull, // 5^-49
+    0xbb127c53b17ec159ull, 0x5560c018580d5d52ull, // 5^-48
+    0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull, // 5^-47
+    0x9226712162ab070dull, 0xcab3961304ca70e8ull, // 5^-46
+    0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull, // 5^-45
+    0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull, // 5^-44
+    0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull, // 5^-43
+    0xb267ed1940f1c61cull, 0x55f038b237591ed3ull, // 5^-42
+    0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull, // 5^-41
+    0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull, // 5^-40
+    0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull, // 5^-39
+    0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull, // 5^-38
+    0x881cea14545c7575ull, 0x7e50d64177da2e54ull, // 5^-37
+    0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull, // 5^-36
+    0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull, // 5^-35
+    0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull, // 5^-34
+    0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull, // 5^-33
+    0xcfb11ead453994baull, 0x67de18eda5814af2ull, // 5^-32
+    0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull, // 5^-31
+    0xa2425ff75e14fc31ull, 0xa1258379a94d028dull, // 5^-30
+    0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull, // 5^-29
+    0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull, // 5^-28
+    0x9e74d1b791e07e48ull, 0x775ea264cf55347eull, // 5^-27
+    0xc612062576589ddaull, 0x95364afe032a819eull, // 5^-26
+    0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull, // 5^-25
+    0x9abe14cd44753b52ull, 0xc4926a9672793543ull, // 5^-24
+    0xc16d9a0095928a27ull, 0x75b7053c0f178294ull, // 5^-23
+    0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull, // 5^-22
+    0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull, // 5^-21
+    0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull, // 5^-20
+    0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull, // 5^-19
+    0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull, // 5^-18
+    0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull, // 5^-17
+    0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull, // 5^-16
+    0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull, // 5^-15
+    0xb424dc35095cd80full, 0x538484c19ef38c95ull, // 5^-14
+    0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull, // 5^-13
+    0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull, // 5^-12
+    0xafebff0bcb24aafeull, 0xf78f69a51539d749ull, // 5^-11
+    0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull, // 5^-10
+    0x89705f4136b4a597ull, 0x31680a88f8953031ull, // 5^-9
+    0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull, // 5^-8
+    0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull, // 5^-7
+    0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull, // 5^-6
+    0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull, // 5^-5
+    0xd1b71758e219652bull, 0xd3c36113404ea4a9ull, // 5^-4
+    0x83126e978d4fdf3bull, 0x645a1cac083126eaull, // 5^-3
+    0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull, // 5^-2
+    0xccccccccccccccccull, 0xcccccccccccccccdull, // 5^-1
+    0x8000000000000000ull, 0x0000000000000000ull, // 5^0
+    0xa000000000000000ull, 0x0000000000000000ull, // 5^1
+    0xc800000000000000ull, 0x0000000000000000ull, // 5^2
+    0xfa00000000000000ull, 0x0000000000000000ull, // 5^3
+    0x9c40000000000000ull, 0x0000000000000000ull, // 5^4
+    0xc350000000000000ull, 0x0000000000000000ull, // 5^5
+    0xf424000000000000ull, 0x0000000000000000ull, // 5^6
+    0x9896800000000000ull, 0x0000000000000000ull, // 5^7
+    0xbebc200000000000ull, 0x0000000000000000ull, // 5^8
+    0xee6b280000000000ull, 0x0000000000000000ull, // 5^9
+    0x9502f90000000000ull, 0x0000000000000000ull, // 5^10
+    0xba43b74000000000ull, 0x0000000000000000ull, // 5^11
+    0xe8d4a51000000000ull, 0x0000000000000000ull, // 5^12
+    0x9184e72a00000000ull, 0x0000000000000000ull, // 5^13
+    0xb5e620f480000000ull, 0x0000000000000000ull, // 5^14
+    0xe35fa931a0000000ull, 0x0000000000000000ull, // 5^15
+    0x8e1bc9bf04000000ull, 0x0000000000000000ull, // 5^16
+    0xb1a2bc2ec5000000ull, 0x0000000000000000ull, // 5^17
+    0xde0b6b3a76400000ull, 0x0000000000000000ull, // 5^18
+    0x8ac7230489e80000ull, 0x0000000000000000ull, // 5^19
+    0xad78ebc5ac620000ull, 0x0000000000000000ull, // 5^20
+    0xd8d726b7177a8000ull, 0x0000000000000000ull, // 5^21
+    0x878678326eac9000ull, 0x0000000000000000ull, // 5^22
+    0xa968163f0a57b400ull, 0x0000000000000000ull, // 5^23
+    0xd3c21bcecceda100ull, 0x0000000000000000ull, // 5^24
+    0x84595161401484a0ull, 0x0000000000000000ull, // 5^25
+    0xa56fa5b99019a5c8ull, 0x0000000000000000ull, // 5^26
+    0xcecb8f27f4200f3aull, 0x0000000000000000ull, // 5^27
+    0x813f3978f8940984ull, 0x4000000000000000ull, // 5^28
+    0xa18f07d736b90be5ull, 0x5000000000000000ull, // 5^29
+    0xc9f2c9cd04674edeull, 0xa400000000000000ull, // 5^30
+    0xfc6f7c4045812296ull, 0x4d00000000000000ull, // 5^31
+    0x9dc5ada82b70b59dull, 0xf020000000000000ull, // 5^32
+    0xc5371912364ce305ull, 0x6c28000000000000ull, // 5^33
+    0xf684df56c3e01bc6ull, 0xc732000000000000ull, // 5^34
+    0x9a130b963a6c115cull, 0x3c7f400000000000ull, // 5^35
+    0xc097ce7bc90715b3ull, 0x4b9f100000000000ull, // 5^36
+    0xf0bdc21abb48db20ull, 0x1e86d40000000000ull, // 5^37
+    0x96769950b50d88f4ull, 0x1314448000000000ull, // 5^38
+};
+
+static const float parse_exact_pow10_f32[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
+
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 parse_u128_t;
+#endif
+
+static inline uint64_t
+parse_mul_64x64(uint64_t a, uint64_t b, uint64_t *lo_o)
+{
+#if defined(__SIZEOF_INT128__)
+    parse_u128_t res = (parse_u128_t)a * b;
+    *lo_o = (uint64_t)res;
+    return (uint64_t)(res >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+
+    uint64_t ll = a_lo * b_lo;
+    uint64_t lh = a_lo * b_hi;
+    uint64_t hl = a_hi * b_lo;
+    uint64_t hh = a_hi * b_hi;
+
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+
+    *lo_o = (mid << 32) | (uint32_t)ll;
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int
+parse_leading_zeros(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+    while (!(value & 0x8000000000000000ull)) {
+        value <<= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/* Eisel-Lemire: float bits (without sign) of `w * 10^q`, `w` non zero.
+ * https://arxiv.org/abs/2101.11408
+ */
+static uint32_t
+parse_eisel_lemire_f32(int64_t q, uint64_t w)
+{
+    if (q < PARSE_F32_MIN_POW10)
+        return 0;
+
+    if (q > PARSE_F32_MAX_POW10)
+        return (uint32_t)PARSE_F32_INFINITE_POWER << PARSE_F32_MANTISSA_BITS;
+
+    int lz = parse_leading_zeros(w);
+    w <<= lz;
+
+    const uint64_t *pow5 = parse_pow5_128 + 2 * (q - PARSE_F32_MIN_POW10);
+
+    uint64_t lo;
+    uint64_t hi = parse_mul_64x64(w, pow5[0], &lo);
+
+    // only the top mantissa + 3 bits matter, refine if they might be off
+    const uint64_t precision_mask = 0xffffffffffffffffull >> (PARSE_F32_MANTISSA_BITS + 3);
+
+    if ((hi & precision_mask) == precision_mask) {
+        uint64_t lo2;
+        uint64_t hi2 = parse_mul_64x64(w, pow5[1], &lo2);
+        (void)lo2;
+
+        lo += hi2;
+        if (hi2 > lo) {
+            ++hi;
+        }
+    }
+
+    int upperbit = (int)(hi >> 63);
+    int shift    = upperbit + 64 - PARSE_F32_MANTISSA_BITS - 3;
+
+    uint64_t mantissa = hi >> shift;
+
+    // floor(q * log2(10)) + 63
+    int32_t power2 = (int32_t)(((152170 + 65536) * q) >> 16) + 63 + upperbit - lz
+                   - PARSE_F32_MIN_EXPONENT;
+
+    if (power2 <= 0) {
+        // subnormal
+        if (-power2 + 1 >= 64)
+            return 0;
+
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+
+        power2 = mantissa < (1ull << PARSE_F32_MANTISSA_BITS) ? 0 : 1;
+
+        return (uint32_t)(mantissa & ((1ull << PARSE_F32_MANTISSA_BITS) - 1))
+             | ((uint32_t)power2 << PARSE_F32_MANTISSA_BITS);
+    }
+
+    // exactly halfway between two floats, round to even
+    if (lo <= 1 && q >= PARSE_F32_MIN_ROUND_EVEN && q <= PARSE_F32_MAX_ROUND_EVEN
+                && (mantissa & 3) == 1) {
+        if ((mantissa << shift) == hi) {
+            mantissa &= ~1ull;
+        }
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+
+    if (mantissa >= (2ull << PARSE_F32_MANTISSA_BITS)) {
+        mantissa = 1ull << PARSE_F32_MANTISSA_BITS;
+        ++power2;
+    }
+
+    mantissa &= ~(1ull << PARSE_F32_MANTISSA_BITS);
+
+    if (power2 >= PARSE_F32_INFINITE_POWER)
+        return (uint32_t)PARSE_F32_INFINITE_POWER << PARSE_F32_MANTISSA_BITS;
+
+    return (uint32_t)mantissa | ((uint32_t)power2 << PARSE_F32_MANTISSA_BITS);
+}
+
+static float
+parse_float_slow(const char *begin, const char *end)
+{
+    char buffer[128];
+    size_t length = end - begin;
+
+    char *copy = length < sizeof(buffer) ? buffer : malloc(length + 1);
+    if (!copy)
         return 0.0f;
+
+    memcpy(copy, begin, length);
+    copy[length] = '\0';
+
+    float res = strtof(copy, NULL);
+
+    if (copy != buffer) {
+        free(copy);
     }
 
-    int sign = 1;
+    return res;
+}
 
-    if (*at == '-') {
-        sign = -1;
+float
+parse_float(const char *begin, const char *end, char **restrict next_o)
+{
+    const char *at = begin;
+
+    while (at != end && is_space(*at)) {
         ++at;
     }
-    else if (*at == '+') {
+
+    const char *start = at;
+
+    int negative = 0;
+
+    if (at != end && (*at == '-' || *at == '+')) {
+        negative = *at == '-';
         ++at;
     }
 
-    int integer = 0;
-    int decimal = 0;
-    int denom = 1;
-    int has_decimal = 0;
+    uint64_t mantissa  = 0;
+    int64_t  exponent  = 0;
+    int      digits    = 0; // significant digits in `mantissa`
+    int      truncated = 0; // non zero digits didn't fit into `mantissa`
+    int      seen      = 0;
 
-    for (; at != end; ++at) {
-        if (!is_digit(*at)) {
-            if (*at == '.') {
-                has_decimal = 1;
-                ++at;
-            }
+    const char *digits_begin = at;
+
+    for (;;) {
+#if PARSE_SWAR
+        if (mantissa && digits + 8 <= 19 && end - at >= 8) {
+            uint64_t chunk = parse_load8(at);
 
+            if (parse_is_eight_digits(chunk)) {
+                mantissa = mantissa * 100000000 + parse_eight_digits(chunk);
+                digits += 8;
+                at     += 8;
+                continue;
+            }
+        }
+#endif
+        if (at == end || !is_digit(*at))
             break;
+
+        int digit = *at - '0';
+
+        if (digits < 19) {
+            mantissa = mantissa * 10 + digit;
+            digits += mantissa != 0;
+        }
+        else {
+            ++exponent;
+            truncated |= digit != 0;
+        }
+
+        ++at;
+    }
+
+    seen = at != digits_begin;
+
+    if (at != end && *at == '.') {
+        ++at;
+
+        const char *fraction_begin = at;
+
+        for (;;) {
+#if PARSE_SWAR
+            if (mantissa && digits + 8 <= 19 && end - at >= 8) {
+                uint64_t chunk = parse_load8(at);
+
+                if (parse_is_eight_digits(chunk)) {
+                    mantissa = mantissa * 100000000 + parse_eight_digits(chunk);
+                    digits   += 8;
+                    exponent -= 8;
+                    at       += 8;
+                    continue;
+                }
+            }
+#endif
+            if (at == end || !is_digit(*at))
+                break;
+
+            int digit = *at - '0';
+
+            if (digits < 19) {
+                mantissa = mantissa * 10 + digit;
+                digits += mantissa != 0;
+                --exponent;
+            }
+            else {
+                truncated |= digit != 0;
+            }
+
+            ++at;
+        }
+
+        seen |= at != fraction_begin;
+    }
+
+    // failed to parse
+    if (!seen) {
+        *next_o = 0;
+        return 0.0f;
+    }
+
+    if (at != end && (*at == 'e' || *at == 'E')) {
+        const char *exp_at = at + 1;
+        int exp_negative = 0;
+
+        if (exp_at != end && (*exp_at == '-' || *exp_at == '+')) {
+            exp_negative = *exp_at == '-';
+            ++exp_at;
+        }
+
+        if (exp_at != end && is_digit(*exp_at)) {
+            int64_t exp_value = 0;
+
+            for (; exp_at != end && is_digit(*exp_at); ++exp_at) {
+                if (exp_value < 0x10000) {
+                    exp_value = exp_value * 10 + (*exp_at - '0');
+                }
+            }
+
+            exponent += exp_negative ? -exp_value : exp_value;
+            at = exp_at;
         }
+    }
+
+    *next_o = (char *)at;
+
+    float res;
+
+    if (mantissa == 0) {
+        res = 0.0f;
+    }
+    else if (!truncated && mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10) {
+        // both operands are exact, a single rounding
+        res = (float)mantissa;
+        res = exponent < 0 ? res / parse_exact_pow10_f32[-exponent]
+                           : res * parse_exact_pow10_f32[exponent];
+    }
+    else {
+        uint32_t bits = parse_eisel_lemire_f32(exponent, mantissa);
+
+        if (truncated && bits != parse_eisel_lemire_f32(exponent, mantissa + 1))
+            return parse_float_slow(start, at);
 
-        integer = integer * 10 + (*at - '0');
+        memcpy(&res, &bits, sizeof(res));
     }
 
-    if (has_decimal) {
-        for (; at != end; ++at) {
-            if (!is_digit(*at))
+    return negative ? -res : res;
+}
+
+size_t
+parse_floats_n(const char *begin, const char *end, float *restrict out, size_t count,
+               char **restrict next_o)
+{
+    const char *at = begin;
+    size_t parsed = 0;
+
+    while (parsed < count) {
+#if defined(__SSE2__)
+        // skip long whitespace runs (indentation, padded columns) 16 at a time
+        while (end - at >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)at);
+
+            // ' ' or '\t'...'\r'
+            __m128i ctrl  = _mm_sub_epi8(chunk, _mm_set1_epi8('\t'));
+            __m128i space = _mm_or_si128(
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                _mm_cmpeq_epi8(_mm_min_epu8(ctrl, _mm_set1_epi8(4)), ctrl)
+            );
+
+            unsigned mask = ~(unsigned)_mm_movemask_epi8(space) & 0xffff;
+
+            if (mask) {
+                at += __builtin_ctz(mask);
                 break;
+            }
 
-            decimal = decimal * 10 + (*at - '0');
-            denom *= 10;
+            at += 16;
         }
+#endif
+        char *next;
+        float value = parse_float(at, end, &next);
+
+        if (!next)
+            break;
+
+        out[parsed++] = value;
+        at = next;
     }
 
     *next_o = (char *)at;
-    return (sign) * ((float)integer + (float)decimal / denom);
+    return parsed;
 }
 
 
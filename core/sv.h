@@ -3,11 +3,32 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SV_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SV_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
+/* Bytes the search functions scan inline before handing the rest to memchr,
+ * which is faster on long runs but costs a call. Most hits in line oriented
+ * text land well within this.
+ */
+#define SV_INLINE_SCAN 64
 
 // usage: printf("Name: "SV_FMT"\n", (int)sv_length(sv), sv.begin);
 #define SV_FMT "%.*s"
 
-#define SV_LIT(cstr_lit) ((sv_t) { .begin = cstr_lit, .end = cstr_lit + sizeof(cstr_lit) + 1 })
+#define SV_LIT(cstr_lit) ((sv_t) { .begin = cstr_lit, .end = cstr_lit + sizeof(cstr_lit) - 1 })
 
 typedef struct
 {
@@ -65,6 +86,229 @@ static inline sv_t sv_l(char *str)
     return res;
 }
 
+static inline bool sv_is_space(char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static inline unsigned sv__ctz(unsigned mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/* Bitmasks of the bytes in a block equal to `c` / that are whitespace. */
+#if SV_AVX2
+static inline unsigned sv__match32(const char *at, __m256i needle)
+{
+    __m256i block = _mm256_loadu_si256((const __m256i *)at);
+    return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+}
+
+static inline unsigned sv__space32(const char *at)
+{
+    __m256i block = _mm256_loadu_si256((const __m256i *)at);
+
+    // '\t'..'\r' end up in 0..4 after the subtraction, everything else above
+    __m256i ctrl = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+    __m256i is_ctrl  = _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, _mm256_set1_epi8('\r' - '\t')), ctrl);
+    __m256i is_blank = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(is_ctrl, is_blank));
+}
+#endif
+
+#if SV_SSE2
+static inline unsigned sv__match16(const char *at, __m128i needle)
+{
+    __m128i block = _mm_loadu_si128((const __m128i *)at);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+}
+
+static inline unsigned sv__space16(const char *at)
+{
+    __m128i block = _mm_loadu_si128((const __m128i *)at);
+
+    __m128i ctrl = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    __m128i is_ctrl  = _mm_cmpeq_epi8(_mm_min_epu8(ctrl, _mm_set1_epi8('\r' - '\t')), ctrl);
+    __m128i is_blank = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(is_ctrl, is_blank));
+}
+#endif
+
+/* Returns a pointer to the first `c` in `sv`, or `sv.end` if there's none. */
+static inline char *sv_find_char(sv_t sv, char c)
+{
+    char *at = sv.begin;
+    char *inline_end = sv_length(sv) > SV_INLINE_SCAN ? sv.begin + SV_INLINE_SCAN : sv.end;
+
+#if SV_AVX2
+    __m256i needle32 = _mm256_set1_epi8(c);
+
+    for (; inline_end - at >= 32; at += 32) {
+        unsigned mask = sv__match32(at, needle32);
+        if (mask)
+            return at + sv__ctz(mask);
+    }
+#endif
+
+#if SV_SSE2
+    __m128i needle16 = _mm_set1_epi8(c);
+
+    for (; inline_end - at >= 16; at += 16) {
+        unsigned mask = sv__match16(at, needle16);
+        if (mask)
+            return at + sv__ctz(mask);
+    }
+#endif
+
+    for (; at < inline_end; ++at) {
+        if (*at == c)
+            return at;
+    }
+
+    if (at == sv.end)
+        return sv.end;
+
+    char *found = memchr(at, c, sv.end - at);
+
+    return found ? found : sv.end;
+}
+
+/* Returns a pointer to the first whitespace character in `sv`, or `sv.end`. */
+static inline char *sv_find_space(sv_t sv)
+{
+    char *at = sv.begin;
+
+    // most tokens are shorter than a block, a plain loop finds those sooner
+    char *scalar_end = sv_length(sv) > 16 ? sv.begin + 16 : sv.end;
+
+    for (; at < scalar_end; ++at) {
+        if (sv_is_space(*at))
+            return at;
+    }
+
+#if SV_AVX2
+    for (; sv.end - at >= 32; at += 32) {
+        unsigned mask = sv__space32(at);
+        if (mask)
+            return at + sv__ctz(mask);
+    }
+#endif
+
+#if SV_SSE2
+    for (; sv.end - at >= 16; at += 16) {
+        unsigned mask = sv__space16(at);
+        if (mask)
+            return at + sv__ctz(mask);
+    }
+#endif
+
+    for (; at < sv.end; ++at) {
+        if (sv_is_space(*at))
+            return at;
+    }
+
+    return sv.end;
+}
+
+/* Whitespace runs at the ends are short, these stay scalar. */
+static inline sv_t sv_trim_left(sv_t sv)
+{
+    while (sv.begin < sv.end && sv_is_space(*sv.begin)) {
+        ++sv.begin;
+    }
+
+    return sv;
+}
+
+static inline sv_t sv_trim_right(sv_t sv)
+{
+    while (sv.end > sv.begin && sv_is_space(sv.end[-1])) {
+        --sv.end;
+    }
+
+    return sv;
+}
+
+static inline sv_t sv_trim(sv_t sv)
+{
+    return sv_trim_right(sv_trim_left(sv));
+}
+
+/* Pops the next whitespace separated token off the front of `*sv` into
+ * `token_o`. Returns false, leaving `*sv` empty, when only whitespace is left.
+ */
+static inline bool sv_next_token(sv_t *sv, sv_t *token_o)
+{
+    sv_t rest = sv_trim_left(*sv);
+
+    if (sv_empty(rest)) {
+        *sv = rest;
+        return false;
+    }
+
+    char *end = sv_find_space(rest);
+
+    *token_o = (sv_t) { rest.begin, end };
+    *sv = (sv_t) { end, rest.end };
+
+    return true;
+}
+
+/* Line iterator, doesn't allocate or modify the text:
+ *
+ *     sv_lines_t lines = sv_split_lines(text);
+ *     sv_t line;
+ *
+ *     while (sv_next_line(&lines, &line)) {
+ *         ...
+ *     }
+ *
+ * Lines end at "\n" or "\r\n", the terminator isn't part of the line. A final
+ * line without a terminator is still returned, a trailing terminator doesn't
+ * start another one. `number` is the 1 based number of the last line returned.
+ */
+typedef struct
+{
+    sv_t rest;
+    size_t number;
+} sv_lines_t;
+
+static inline sv_lines_t sv_split_lines(sv_t sv)
+{
+    return (sv_lines_t) { .rest = sv };
+}
+
+static inline bool sv_next_line(sv_lines_t *lines, sv_t *line_o)
+{
+    sv_t rest = lines->rest;
+
+    if (sv_empty(rest))
+        return false;
+
+    char *eol = sv_find_char(rest, '\n');
+
+    sv_t line = { rest.begin, eol };
+
+    if (line.end > line.begin && line.end[-1] == '\r') {
+        --line.end;
+    }
+
+    lines->rest.begin = eol < rest.end ? eol + 1 : rest.end;
+    lines->number += 1;
+
+    *line_o = line;
+
+    return true;
+}
+
 
 typedef struct
 {
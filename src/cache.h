@@ -0,0 +1,184 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+/* On-disk cache shared by the asset loaders.
+ *
+ * Every cached artifact lives in `CACHE_DIR`, named after the source it was
+ * derived from. Files are written to a temporary name first and renamed into
+ * place, so a crash mid-write never leaves a truncated cache entry behind.
+ */
+
+#include "core/utils.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/stat.h>
+
+#define CACHE_DIR "cache"
+
+#define CACHE_HASH_SEED 0xcbf29ce484222325ull
+
+typedef struct
+{
+    i64 sec;
+    i64 nsec;
+    u64 size;
+} cache_stamp_t;
+
+/* FNV-1a, chainable through `seed`. Start with `CACHE_HASH_SEED`. */
+static inline u64
+cache_hash(const void *data, size_t size, u64 seed)
+{
+    const u8 *bytes = data;
+    u64 hash = seed;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static inline b32
+cache_stamp_eq(cache_stamp_t a, cache_stamp_t b)
+{
+    return a.sec == b.sec && a.nsec == b.nsec && a.size == b.size;
+}
+
+/* Returns false if `path` can't be stat'd. */
+b32
+cache_stamp_get(const char *path, cache_stamp_t *stamp_o)
+{
+    struct stat st;
+
+    if (stat(path, &st))
+        return false;
+
+    *stamp_o = (cache_stamp_t) {
+        .sec  = st.st_mtim.tv_sec,
+        .nsec = st.st_mtim.tv_nsec,
+        .size = st.st_size,
+    };
+
+    return true;
+}
+
+b32
+cache_dir_assure(void)
+{
+    if (mkdir(CACHE_DIR, 0777) && errno != EEXIST) {
+        fprintf(stderr, "Failed to create cache directory '%s': %s\n", CACHE_DIR, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/* Returns an allocated path inside `CACHE_DIR` for an artifact derived from
+ * `source`, e.g. "res/wood.png" + ".btex" -> "cache/res_wood.png.btex".
+ */
+char *
+cache_path(const char *source, const char *ext)
+{
+    size_t dir_len = strlen(CACHE_DIR);
+    size_t src_len = strlen(source);
+    size_t ext_len = strlen(ext);
+
+    char *path = malloc(dir_len + 1 + src_len + ext_len + 1);
+    if (!path) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    char *at = path;
+
+    memcpy(at, CACHE_DIR, dir_len);
+    at += dir_len;
+    *at++ = '/';
+
+    for (size_t i = 0; i < src_len; ++i) {
+        char c = source[i];
+        *at++ = (c == '/' || c == '\\' || c == ':') ? '_' : c;
+    }
+
+    memcpy(at, ext, ext_len + 1);
+
+    return path;
+}
+
+/* Writes `header` followed by `data` into `path` atomically. */
+b32
+cache_write(const char *path, const void *header, size_t header_size,
+                              const void *data,   size_t data_size)
+{
+    if (!cache_dir_assure())
+        return false;
+
+    size_t path_len = strlen(path);
+
+    char *tmp_path = malloc(path_len + sizeof(".tmp"));
+    if (!tmp_path)
+        return false;
+
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", sizeof(".tmp"));
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file)
+        goto error_exit;
+
+    if (fwrite(header, 1, header_size, file) != header_size)
+        goto error_exit;
+
+    if (data_size && fwrite(data, 1, data_size, file) != data_size)
+        goto error_exit;
+
+    if (fclose(file)) {
+        file = NULL;
+        goto error_exit;
+    }
+    file = NULL;
+
+    if (rename(tmp_path, path))
+        goto error_exit;
+
+    free(tmp_path);
+    return true;
+
+error_exit:
+    fprintf(stderr, "Failed to write cache file '%s': %s\n", path, strerror(errno));
+
+    if (file) {
+        fclose(file);
+    }
+
+    remove(tmp_path);
+    free(tmp_path);
+
+    return false;
+}
+
+/* Overwrites the leading `header_size` bytes of an existing cache file, used
+ * to refresh the source stamp of an entry whose contents are still valid.
+ */
+b32
+cache_rewrite_header(const char *path, const void *header, size_t header_size)
+{
+    FILE *file = fopen(path, "r+b");
+    if (!file)
+        return false;
+
+    b32 ok = fwrite(header, 1, header_size, file) == header_size;
+
+    if (fclose(file))
+        ok = false;
+
+    return ok;
+}
+
+#endif // CACHE_H_
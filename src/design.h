@@ -0,0 +1,789 @@
+#ifndef DESIGN_H_
+#define DESIGN_H_
+
+/* Text design files.
+ *
+ * A design lists the parts of an assembly, one statement per line:
+ *
+ *     # comment
+ *     let <name> <expression>
+ *     plank  <length> <width> <depth>                   [transform]
+ *     angled <length> <width> <depth> <angle1> <angle2> [transform]
+ *     group [transform] {
+ *         ...
+ *     }
+ *     dupe [transform]
+ *
+ * A transform is any of `at <x> <y> <z>`, `rot <x> <y> <z> <degrees>` and
+ * `scale <x> <y> <z>`, combined like `matrix_from`: scale, rotate, translate.
+ * `dupe` repeats the closest plank, angled plank or group above it in the
+ * same group, with its own transform applied after the original one.
+ *
+ * Arguments are numbers (`2`, `0.5`, `.5`, `1e-3`), names bound by `let`, or
+ * expressions of those with + - * /, sqrt() and parentheses. Spaces are only
+ * allowed inside parentheses, except in `let`, which takes the rest of the
+ * line.
+ *
+ * Building flattens the tree into parts, each a primitive with its final
+ * matrix. A part's geometry only depends on its key, a hash of both, so a
+ * rebuild after an edit copies every part whose key is in the previous build
+ * and only generates the ones that changed. The changed ones are generated
+ * through a tape (tape.h), in chunks that run on the job pool, with repeated
+ * primitives emitted once.
+ */
+
+#include "core/utils.h"
+#include "core/dck.h"
+#include "core/io.h"
+#include "core/parse.h"
+#include "core/sv.h"
+
+#include "cache.h"
+#include "mb.h"
+#include "tape.h"
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define DESIGN_MAX_ARGS         5
+#define DESIGN_MAX_DEPTH        32
+#define DESIGN_NO_NODE          ((u32)-1)
+
+/* Generated parts per tape group, the unit of work on the job pool. */
+#define DESIGN_TAPE_CHUNK       256
+
+/* Seconds between source stamp checks while watching. */
+#define DESIGN_WATCH_INTERVAL   0.25
+
+typedef enum
+{
+    design_Plank,
+    design_Angled,
+    design_Group,
+    design_Dupe,
+} design_kind_t;
+
+/* Nodes are stored in file order. A group's descendants are the nodes right
+ * after it, up to its `end`, for every other node `end` is the next index.
+ */
+typedef struct
+{
+    u32 kind;
+    u32 line;
+
+    u32 end;
+    u32 source; // dupe: the repeated node
+
+    f32 args[DESIGN_MAX_ARGS];
+    affine_t transform;
+} design_node_t;
+
+typedef struct
+{
+    dck_stretchy_t (design_node_t, u32) nodes;
+
+    u32  error_line;
+    char error[128];
+} design_t;
+
+typedef struct
+{
+    u32 kind;
+    f32 args[DESIGN_MAX_ARGS];
+    affine_t matrix;
+
+    u64 key;
+    mb_view_t view;
+} design_part_t;
+
+typedef struct
+{
+    mb_t mb;
+    dck_stretchy_t (design_part_t, u32) parts;
+
+    u32 reused;
+    u32 generated;
+} design_model_t;
+
+/* Emits primitive `kind` (design_Plank or design_Angled) with `args` in its
+ * local space, possibly from a pool thread.
+ */
+typedef tape_emit_t design_emit_t;
+
+typedef struct
+{
+    const char *path;
+    cache_stamp_t stamp;
+
+    f64 last_check;
+} design_watch_t;
+
+
+typedef struct
+{
+    sv_t name;
+    f32 value;
+} design_var_t;
+
+typedef struct
+{
+    design_t *design;
+
+    dck_stretchy_t (design_var_t, u32) vars;
+
+    u32 line;
+    b32 failed;
+} design_parser_t;
+
+/* Records the first error only, everything after it is likely a consequence. */
+void
+design_fail(design_parser_t *parser, const char *fmt, ...)
+{
+    if (parser->failed)
+        return;
+
+    parser->failed = true;
+    parser->design->error_line = parser->line;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(parser->design->error, sizeof(parser->design->error), fmt, args);
+    va_end(args);
+}
+
+static inline b32
+design_is_name(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || is_digit(c);
+}
+
+static inline void
+design_skip_space(sv_t *sv)
+{
+    *sv = sv_trim_left(*sv);
+}
+
+f32 design_expr(design_parser_t *parser, sv_t *sv, u32 depth);
+
+f32
+design_factor(design_parser_t *parser, sv_t *sv, u32 depth)
+{
+    if (depth > DESIGN_MAX_DEPTH) {
+        design_fail(parser, "expression nested too deep");
+        return 0.0f;
+    }
+
+    design_skip_space(sv);
+
+    if (sv_empty(*sv)) {
+        design_fail(parser, "expected a value");
+        return 0.0f;
+    }
+
+    char c = *sv->begin;
+
+    if (c == '-') {
+        ++sv->begin;
+        return -design_factor(parser, sv, depth + 1);
+    }
+
+    if (c == '(') {
+        ++sv->begin;
+        f32 value = design_expr(parser, sv, depth + 1);
+
+        design_skip_space(sv);
+
+        if (sv_empty(*sv) || *sv->begin != ')') {
+            design_fail(parser, "missing ')'");
+            return 0.0f;
+        }
+
+        ++sv->begin;
+        return value;
+    }
+
+    if (is_digit(c) || c == '.') {
+        char *next;
+        f32 value = parse_float(sv->begin, sv->end, &next);
+
+        if (!next) {
+            design_fail(parser, "bad number '" SV_FMT "'", (int)sv_length(*sv), sv->begin);
+            return 0.0f;
+        }
+
+        sv->begin = next;
+        return value;
+    }
+
+    if (design_is_name(c)) {
+        sv_t name = { sv->begin, sv->begin };
+
+        while (name.end < sv->end && design_is_name(*name.end)) {
+            ++name.end;
+        }
+
+        sv->begin = name.end;
+
+        if (sv_is(name, "sqrt")) {
+            design_skip_space(sv);
+
+            if (sv_empty(*sv) || *sv->begin != '(') {
+                design_fail(parser, "expected '(' after sqrt");
+                return 0.0f;
+            }
+
+            return sqrtf(design_factor(parser, sv, depth + 1));
+        }
+
+        dck_stretchy_for (parser->vars, design_var_t, var) {
+            if (sv_eq(var->name, name))
+                return var->value;
+        }
+
+        design_fail(parser, "unknown name '" SV_FMT "'", (int)sv_length(name), name.begin);
+        return 0.0f;
+    }
+
+    design_fail(parser, "unexpected '%c'", c);
+    return 0.0f;
+}
+
+f32
+design_term(design_parser_t *parser, sv_t *sv, u32 depth)
+{
+    f32 value = design_factor(parser, sv, depth);
+
+    for (;;) {
+        design_skip_space(sv);
+
+        if (sv_empty(*sv) || (*sv->begin != '*' && *sv->begin != '/'))
+            return value;
+
+        char op = *sv->begin++;
+        f32 rhs = design_factor(parser, sv, depth);
+
+        value = op == '*' ? value * rhs : value / rhs;
+    }
+}
+
+f32
+design_expr(design_parser_t *parser, sv_t *sv, u32 depth)
+{
+    f32 value = design_term(parser, sv, depth);
+
+    for (;;) {
+        design_skip_space(sv);
+
+        if (sv_empty(*sv) || (*sv->begin != '+' && *sv->begin != '-'))
+            return value;
+
+        char op = *sv->begin++;
+        f32 rhs = design_term(parser, sv, depth);
+
+        value = op == '+' ? value + rhs : value - rhs;
+    }
+}
+
+/* Evaluates all of `sv` as one expression. */
+f32
+design_eval(design_parser_t *parser, sv_t sv)
+{
+    f32 value = design_expr(parser, &sv, 0);
+
+    design_skip_space(&sv);
+
+    if (!sv_empty(sv)) {
+        design_fail(parser, "unexpected '" SV_FMT "'", (int)sv_length(sv), sv.begin);
+    }
+
+    return value;
+}
+
+/* Pops the next argument off `*sv`. Arguments end at whitespace outside of
+ * parentheses.
+ */
+b32
+design_next_arg(sv_t *sv, sv_t *arg_o)
+{
+    design_skip_space(sv);
+
+    if (sv_empty(*sv))
+        return false;
+
+    char *at = sv->begin;
+    i32 depth = 0;
+
+    for (; at < sv->end; ++at) {
+        if (*at == '(') {
+            ++depth;
+        }
+        else if (*at == ')') {
+            --depth;
+        }
+        else if (depth <= 0 && sv_is_space(*at)) {
+            break;
+        }
+    }
+
+    *arg_o = (sv_t) { sv->begin, at };
+    sv->begin = at;
+
+    return true;
+}
+
+void
+design_args(design_parser_t *parser, sv_t *sv, f32 *out, u32 count, const char *what)
+{
+    for (u32 i = 0; i < count; ++i) {
+        sv_t arg;
+
+        if (!design_next_arg(sv, &arg)) {
+            design_fail(parser, "%s takes %u arguments, got %u", what, count, i);
+            return;
+        }
+
+        out[i] = design_eval(parser, arg);
+    }
+}
+
+/* Parses the transform clauses left on the line. Returns whether the line
+ * ended with '{', which only groups accept.
+ */
+b32
+design_transform(design_parser_t *parser, sv_t *sv, affine_t *transform_o)
+{
+    Vector3 position = { 0.0f, 0.0f, 0.0f };
+    Vector3 axis     = { 0.0f, 1.0f, 0.0f };
+    Vector3 scale    = { 1.0f, 1.0f, 1.0f };
+    f32     angle    = 0.0f;
+
+    b32 open = false;
+    sv_t word;
+
+    while (!parser->failed && sv_next_token(sv, &word)) {
+        if (open) {
+            design_fail(parser, "unexpected '" SV_FMT "' after '{'", (int)sv_length(word), word.begin);
+        }
+        else if (sv_is(word, "at")) {
+            design_args(parser, sv, &position.x, 3, "at");
+        }
+        else if (sv_is(word, "rot")) {
+            f32 rot[4];
+            design_args(parser, sv, rot, 4, "rot");
+
+            axis  = (Vector3) { rot[0], rot[1], rot[2] };
+            angle = rot[3];
+
+            if (!parser->failed && Vector3Length(axis) == 0.0f) {
+                design_fail(parser, "rotation axis can't be zero");
+            }
+        }
+        else if (sv_is(word, "scale")) {
+            design_args(parser, sv, &scale.x, 3, "scale");
+        }
+        else if (sv_is(word, "{")) {
+            open = true;
+        }
+        else {
+            design_fail(parser, "unexpected '" SV_FMT "'", (int)sv_length(word), word.begin);
+        }
+    }
+
+    *transform_o = affine_trs(mb_vec3(position), mb_vec3(axis), angle * DEG2RAD, mb_vec3(scale));
+
+    return open;
+}
+
+/* Parses `text` into `design_o`. On failure `error` and `error_line`
+ * describe the first problem.
+ */
+b32
+design_parse(sv_t text, design_t *design_o)
+{
+    *design_o = (design_t) {0};
+
+    design_parser_t parser = { .design = design_o };
+
+    // open groups, and the last node each of them could dupe
+    u32 groups[DESIGN_MAX_DEPTH];
+    u32 lasts [DESIGN_MAX_DEPTH + 1];
+    u32 depth = 0;
+
+    lasts[0] = DESIGN_NO_NODE;
+
+    sv_lines_t lines = sv_split_lines(text);
+    sv_t line;
+
+    while (!parser.failed && sv_next_line(&lines, &line)) {
+        parser.line = lines.number;
+
+        line = sv_trim(line);
+
+        if (sv_empty(line) || *line.begin == '#')
+            continue;
+
+        sv_t word;
+
+        if (!sv_next_token(&line, &word))
+            continue;
+
+        if (sv_is(word, "}")) {
+            if (!depth) {
+                design_fail(&parser, "'}' without a group");
+                break;
+            }
+
+            if (!sv_empty(sv_trim(line))) {
+                design_fail(&parser, "unexpected text after '}'");
+                break;
+            }
+
+            u32 group = groups[--depth];
+            design_o->nodes.data[group].end = design_o->nodes.count;
+            lasts[depth] = group;
+
+            continue;
+        }
+
+        if (sv_is(word, "let")) {
+            sv_t name;
+
+            if (!sv_next_token(&line, &name) || !design_is_name(*name.begin) || is_digit(*name.begin)) {
+                design_fail(&parser, "let needs a name");
+                break;
+            }
+
+            f32 value = design_eval(&parser, line);
+
+            dck_stretchy_for (parser.vars, design_var_t, var) {
+                if (sv_eq(var->name, name)) {
+                    design_fail(&parser, "'" SV_FMT "' is already defined", (int)sv_length(name), name.begin);
+                }
+            }
+
+            dck_stretchy_push(parser.vars, (design_var_t) { name, value });
+
+            continue;
+        }
+
+        u32 index = design_o->nodes.count;
+
+        design_node_t node = {
+            .line   = parser.line,
+            .end    = index + 1,
+            .source = DESIGN_NO_NODE,
+        };
+
+        if (sv_is(word, "plank")) {
+            node.kind = design_Plank;
+            design_args(&parser, &line, node.args, 3, "plank");
+        }
+        else if (sv_is(word, "angled")) {
+            node.kind = design_Angled;
+            design_args(&parser, &line, node.args, 5, "angled");
+        }
+        else if (sv_is(word, "group")) {
+            node.kind = design_Group;
+        }
+        else if (sv_is(word, "dupe")) {
+            node.kind   = design_Dupe;
+            node.source = lasts[depth];
+
+            if (node.source == DESIGN_NO_NODE) {
+                design_fail(&parser, "nothing to dupe");
+            }
+        }
+        else {
+            design_fail(&parser, "unknown statement '" SV_FMT "'", (int)sv_length(word), word.begin);
+        }
+
+        b32 open = design_transform(&parser, &line, &node.transform);
+
+        if (parser.failed)
+            break;
+
+        if (open != (node.kind == design_Group)) {
+            design_fail(&parser, open ? "only groups open a block" : "group needs a '{'");
+            break;
+        }
+
+        dck_stretchy_push(design_o->nodes, node);
+
+        if (node.kind == design_Group) {
+            if (depth == DESIGN_MAX_DEPTH) {
+                design_fail(&parser, "groups nested too deep");
+                break;
+            }
+
+            groups[depth++] = index;
+            lasts[depth] = DESIGN_NO_NODE;
+        }
+        else if (node.kind != design_Dupe) {
+            lasts[depth] = index;
+        }
+    }
+
+    if (!parser.failed && depth) {
+        parser.line = design_o->nodes.data[groups[depth - 1]].line;
+        design_fail(&parser, "group is never closed");
+    }
+
+    dck_stretchy_free(parser.vars);
+
+    return !parser.failed;
+}
+
+void
+design_free(design_t *design)
+{
+    dck_stretchy_free(design->nodes);
+    *design = (design_t) {0};
+}
+
+/* Reads and parses the design at `path`, reports errors on stderr. */
+b32
+design_load(const char *path, design_t *design_o)
+{
+    io_map_t map;
+
+    if (!io_map_file(path, io_map_Sequential, &map)) {
+        fprintf(stderr, "Failed to read design: %s\n", path);
+        *design_o = (design_t) {0};
+        return false;
+    }
+
+    b32 ok = design_parse((sv_t) { map.begin, map.end }, design_o);
+
+    io_unmap_file(&map);
+
+    if (!ok) {
+        fprintf(stderr, "%s:%u: %s\n", path, design_o->error_line, design_o->error);
+        design_free(design_o);
+    }
+
+    return ok;
+}
+
+void
+design_flatten(const design_t *design, u32 index, affine_t after, design_model_t *model)
+{
+    const design_node_t *node = design->nodes.data + index;
+
+    affine_t matrix = affine_mul(after, node->transform);
+
+    if (node->kind == design_Group) {
+        for (u32 i = index + 1; i < node->end; i = design->nodes.data[i].end) {
+            design_flatten(design, i, matrix, model);
+        }
+    }
+    else if (node->kind == design_Dupe) {
+        design_flatten(design, node->source, matrix, model);
+    }
+    else {
+        design_part_t part = {
+            .kind   = node->kind,
+            .matrix = matrix,
+        };
+
+        memcpy(part.args, node->args, sizeof(part.args));
+
+        part.key = cache_hash(&part.kind,  sizeof(part.kind),   CACHE_HASH_SEED);
+        part.key = cache_hash(part.args,   sizeof(part.args),   part.key);
+        part.key = cache_hash(&part.matrix, sizeof(part.matrix), part.key);
+
+        dck_stretchy_push(model->parts, part);
+    }
+}
+
+typedef struct
+{
+    u64 key;
+    u32 part;
+} design_key_t;
+
+int
+design_key_cmp(const void *a, const void *b)
+{
+    u64 ka = ((const design_key_t *)a)->key;
+    u64 kb = ((const design_key_t *)b)->key;
+
+    return (ka > kb) - (ka < kb);
+}
+
+/* Whether two parts generate the same geometry, keys only narrow it down. */
+static inline b32
+design_part_eq(const design_part_t *a, const design_part_t *b)
+{
+    return a->kind == b->kind
+        && memcmp(a->args, b->args, sizeof(a->args)) == 0
+        && memcmp(&a->matrix, &b->matrix, sizeof(a->matrix)) == 0;
+}
+
+/* Previous part with the same contents as `part`, NULL if there's none. */
+const design_part_t *
+design_find_previous(const design_model_t *previous, const design_key_t *keys, u32 key_count,
+                     const design_part_t *part)
+{
+    if (!key_count)
+        return NULL;
+
+    design_key_t needle = { part->key, 0 };
+    design_key_t *found = bsearch(&needle, keys, key_count, sizeof(*keys), design_key_cmp);
+
+    if (!found)
+        return NULL;
+
+    // bsearch lands anywhere in a run of equal keys, walk back to its start
+    while (found > keys && found[-1].key == part->key) {
+        --found;
+    }
+
+    for (; found < keys + key_count && found->key == part->key; ++found) {
+        const design_part_t *candidate = previous->parts.data + found->part;
+
+        if (design_part_eq(candidate, part))
+            return candidate;
+    }
+
+    return NULL;
+}
+
+/* Builds `design` into `model_o`. Parts found in `previous` (may be NULL)
+ * are copied from it, the others are generated through `emit`, on `jobs`
+ * unless it's NULL.
+ */
+void
+design_build(const design_t *design, const design_model_t *previous, design_emit_t emit, jobs_t *jobs,
+             design_model_t *model_o)
+{
+    *model_o = (design_model_t) {0};
+
+    for (u32 i = 0; i < design->nodes.count; i = design->nodes.data[i].end) {
+        design_flatten(design, i, affine_identity(), model_o);
+    }
+
+    u32 key_count = previous ? previous->parts.count : 0;
+    design_key_t *keys = NULL;
+
+    if (key_count) {
+        keys = mem_alloc(mem_tag(), key_count * sizeof(*keys));
+        if (!keys) {
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+            exit(666);
+        }
+
+        for (u32 i = 0; i < key_count; ++i) {
+            keys[i] = (design_key_t) { previous->parts.data[i].key, i };
+        }
+
+        qsort(keys, key_count, sizeof(*keys), design_key_cmp);
+    }
+
+    mb_t *mb = &model_o->mb;
+
+    // edits rarely change the size much, reserving avoids growing in steps
+    if (previous) {
+        dck_stretchy_reserve(mb->positions, previous->mb.positions.count);
+        dck_stretchy_reserve(mb->normals,   previous->mb.positions.count);
+        dck_stretchy_reserve(mb->texcoords, previous->mb.positions.count);
+    }
+
+    // parts to generate go on the tape first, their views are filled in by
+    // slot once it ran, the reused ones are copied after them
+    tape_t tape = {0};
+    u32 chunk = 0;
+    u32 chunk_size = 0;
+
+    dck_stretchy_for (model_o->parts, design_part_t, part) {
+        const design_part_t *found = design_find_previous(previous, keys, key_count, part);
+
+        if (found) {
+            part->view = found->view;
+            continue;
+        }
+
+        if (!chunk_size) {
+            chunk = tape_begin(&tape);
+        }
+
+        u32 slot = tape_emit(&tape, part->kind, part->args, DESIGN_MAX_ARGS, tape_None);
+        tape_transform(&tape, slot, part->matrix);
+
+        // reused parts have a view into the previous mb, mark generated ones
+        part->view = (mb_view_t) { slot, (u32)-1 };
+
+        if (++chunk_size == DESIGN_TAPE_CHUNK) {
+            tape_end(&tape, chunk);
+            chunk_size = 0;
+        }
+    }
+
+    if (chunk_size) {
+        tape_end(&tape, chunk);
+    }
+
+    tape_run(&tape, mb, NULL, emit, jobs);
+
+    dck_stretchy_for (model_o->parts, design_part_t, part) {
+        if (part->view.vertex_count == (u32)-1) {
+            part->view = tape.views[part->view.vertex_start];
+            model_o->generated += 1;
+        }
+        else {
+            part->view = mb_view_copy(mb, (mb_t *)&previous->mb, part->view);
+            model_o->reused += 1;
+        }
+    }
+
+    tape_free(&tape);
+    mem_free(keys);
+}
+
+void
+design_model_free(design_model_t *model)
+{
+    mb_free(&model->mb);
+    dck_stretchy_free(model->parts);
+
+    *model = (design_model_t) {0};
+}
+
+design_watch_t
+design_watch_create(const char *path)
+{
+    design_watch_t watch = {
+        .path       = path,
+        .last_check = GetTime(),
+    };
+
+    cache_stamp_get(path, &watch.stamp);
+
+    return watch;
+}
+
+/* Returns true once the file changed on disk since the last call. */
+b32
+design_watch_poll(design_watch_t *watch)
+{
+    f64 now = GetTime();
+
+    if (now - watch->last_check < DESIGN_WATCH_INTERVAL)
+        return false;
+
+    watch->last_check = now;
+
+    cache_stamp_t stamp;
+
+    if (!cache_stamp_get(watch->path, &stamp) || cache_stamp_eq(stamp, watch->stamp))
+        return false;
+
+    watch->stamp = stamp;
+
+    return true;
+}
+
+#endif // DESIGN_H_
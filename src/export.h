@@ -0,0 +1,1027 @@
+#ifndef EXPORT_H_
+#define EXPORT_H_
+
+/* Mesh exporters.
+ *
+ * Write the triangles of a set of views of an `mb_t` as binary STL, binary
+ * PLY, OBJ or binary glTF. Everything is streamed through an `io_writer_t`, the output is
+ * never held in memory as a whole. Passing no views exports the whole
+ * builder.
+ *
+ * The binary formats are written in host byte order and declared little
+ * endian, which is what every target we build for is.
+ */
+
+#include "core/utils.h"
+#include "core/io.h"
+#include "core/fmt.h"
+
+#include "cache.h"
+#include "mb.h"
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+typedef enum
+{
+    export_None     = 0,
+    export_Quantize = (1 << 0), // glb: 16 bit positions, 8 bit normals (KHR_mesh_quantization)
+} export_flags_t;
+
+#define EXPORT_STL_TRIANGLE_SIZE 50
+#define EXPORT_PLY_VERTEX_SIZE   (8 * sizeof(f32))
+#define EXPORT_PLY_FACE_SIZE     (1 + 3 * sizeof(u32))
+
+/* Longest line the OBJ exporter formats in one go. */
+#define EXPORT_OBJ_LINE_MAX 128
+
+
+/* Resolves the `views` argument of the exporters, NULL means all of `mb`. */
+static inline const mb_view_t *
+export_views(mb_t *mb, const mb_view_t *views, u32 *view_count, mb_view_t *all)
+{
+    if (views)
+        return views;
+
+    *all = (mb_view_t) {
+        .vertex_start = 0,
+        .vertex_count = mb->positions.count,
+    };
+    *view_count = 1;
+
+    return all;
+}
+
+static inline u64
+export_triangle_count(const mb_view_t *views, u32 view_count)
+{
+    u64 count = 0;
+
+    for (u32 i = 0; i < view_count; ++i) {
+        count += views[i].vertex_count / 3;
+    }
+
+    return count;
+}
+
+static b32
+export_open(io_writer_t *writer, const char *path)
+{
+    if (!io_writer_open(writer, path, 0)) {
+        fprintf(stderr, "Failed to open export file: %s\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+static b32
+export_close(io_writer_t *writer, const char *path)
+{
+    if (!io_writer_close(writer)) {
+        fprintf(stderr, "Failed to write export file: %s\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+b32
+export_stl(const char *path, mb_t *mb, const mb_view_t *views, u32 view_count)
+{
+    mb_view_t all;
+    views = export_views(mb, views, &view_count, &all);
+
+    u64 triangle_count = export_triangle_count(views, view_count);
+
+    if (triangle_count > UINT32_MAX) {
+        fprintf(stderr, "Too many triangles for STL: %s\n", path);
+        return false;
+    }
+
+    io_writer_t writer;
+    if (!export_open(&writer, path))
+        return false;
+
+    char header[80] = "binary STL";
+    u32 count = (u32)triangle_count;
+
+    io_writer_write(&writer, header, sizeof(header));
+    io_writer_write(&writer, &count, sizeof(count));
+
+    for (u32 v = 0; v < view_count; ++v) {
+        const Vector3 *positions = mb->positions.data + views[v].vertex_start;
+        u32 triangles = views[v].vertex_count / 3;
+
+        for (u32 i = 0; i < triangles; ++i) {
+            const Vector3 *p = positions + i * 3;
+
+            Vector3 normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p[1], p[0]),
+                                                                  Vector3Subtract(p[2], p[0])));
+
+            char *at = io_writer_reserve(&writer, EXPORT_STL_TRIANGLE_SIZE);
+
+            memcpy(at,      &normal, sizeof(Vector3));
+            memcpy(at + 12, p,       sizeof(Vector3) * 3);
+            memset(at + 48, 0,       sizeof(u16));
+
+            io_writer_commit(&writer, EXPORT_STL_TRIANGLE_SIZE);
+        }
+    }
+
+    return export_close(&writer, path);
+}
+
+b32
+export_ply(const char *path, mb_t *mb, const mb_view_t *views, u32 view_count)
+{
+    mb_view_t all;
+    views = export_views(mb, views, &view_count, &all);
+
+    u64 triangle_count = export_triangle_count(views, view_count);
+
+    io_writer_t writer;
+    if (!export_open(&writer, path))
+        return false;
+
+    char header[512];
+    i32 header_len = snprintf(header, sizeof(header),
+        "ply\n"
+        "format binary_little_endian 1.0\n"
+        "element vertex %llu\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n"
+        "property float nx\n"
+        "property float ny\n"
+        "property float nz\n"
+        "property float s\n"
+        "property float t\n"
+        "element face %llu\n"
+        "property list uchar uint vertex_indices\n"
+        "end_header\n",
+        (unsigned long long)(triangle_count * 3),
+        (unsigned long long)triangle_count);
+
+    io_writer_write(&writer, header, header_len);
+
+    // vertices are stored separately, interleave them on the way out
+    for (u32 v = 0; v < view_count; ++v) {
+        u32 start = views[v].vertex_start;
+        u32 end   = start + views[v].vertex_count / 3 * 3;
+
+        for (u32 i = start; i < end; ++i) {
+            char *at = io_writer_reserve(&writer, EXPORT_PLY_VERTEX_SIZE);
+
+            memcpy(at,      mb->positions.data + i, sizeof(Vector3));
+            memcpy(at + 12, mb->normals.data   + i, sizeof(Vector3));
+            memcpy(at + 24, mb->texcoords.data + i, sizeof(Vector2));
+
+            io_writer_commit(&writer, EXPORT_PLY_VERTEX_SIZE);
+        }
+    }
+
+    u32 index = 0;
+
+    for (u64 i = 0; i < triangle_count; ++i) {
+        char *at = io_writer_reserve(&writer, EXPORT_PLY_FACE_SIZE);
+
+        u32 face[3] = { index, index + 1, index + 2 };
+        index += 3;
+
+        at[0] = 3;
+        memcpy(at + 1, face, sizeof(face));
+
+        io_writer_commit(&writer, EXPORT_PLY_FACE_SIZE);
+    }
+
+    return export_close(&writer, path);
+}
+
+/* Writes `prefix` followed by `count` space separated floats as a line. */
+static inline void
+export_obj_floats(io_writer_t *writer, const char *prefix, const f32 *values, u32 count)
+{
+    char *begin = io_writer_reserve(writer, EXPORT_OBJ_LINE_MAX);
+    char *at    = begin;
+
+    size_t prefix_len = strlen(prefix);
+    memcpy(at, prefix, prefix_len);
+    at += prefix_len;
+
+    for (u32 i = 0; i < count; ++i) {
+        *at++ = ' ';
+        at += fmt_f32(at, values[i]);
+    }
+
+    *at++ = '\n';
+
+    io_writer_commit(writer, at - begin);
+}
+
+/* Writes the face of the three vertices starting at `index`, every vertex
+ * uses the same index for its position, texcoord and normal.
+ */
+static inline void
+export_obj_face(io_writer_t *writer, u32 index)
+{
+    char *begin = io_writer_reserve(writer, EXPORT_OBJ_LINE_MAX);
+    char *at    = begin;
+
+    *at++ = 'f';
+
+    for (u32 i = index; i < index + 3; ++i) {
+        *at++ = ' ';
+
+        size_t len = fmt_u32(at, i);
+        at[len] = '/';
+        memcpy(at + len + 1, at, len);
+        at[2 * len + 1] = '/';
+        memcpy(at + 2 * len + 2, at, len);
+
+        at += 3 * len + 2;
+    }
+
+    *at++ = '\n';
+
+    io_writer_commit(writer, at - begin);
+}
+
+/* Every vertex gets its own v/vt/vn triple, one group per view when there are
+ * several of them.
+ */
+b32
+export_obj(const char *path, mb_t *mb, const mb_view_t *views, u32 view_count)
+{
+    mb_view_t all;
+    views = export_views(mb, views, &view_count, &all);
+
+    io_writer_t writer;
+    if (!export_open(&writer, path))
+        return false;
+
+    const char *header = "# exported mesh\n";
+    io_writer_write(&writer, header, strlen(header));
+
+    u32 base = 1;
+
+    for (u32 v = 0; v < view_count; ++v) {
+        u32 start = views[v].vertex_start;
+        u32 end   = start + views[v].vertex_count / 3 * 3;
+
+        if (view_count > 1) {
+            char *begin = io_writer_reserve(&writer, EXPORT_OBJ_LINE_MAX);
+            char *at    = begin;
+
+            memcpy(at, "g view", 6);
+            at += 6;
+            at += fmt_u32(at, v);
+            *at++ = '\n';
+
+            io_writer_commit(&writer, at - begin);
+        }
+
+        for (u32 i = start; i < end; ++i) {
+            export_obj_floats(&writer, "v", (const f32 *)(mb->positions.data + i), 3);
+        }
+
+        for (u32 i = start; i < end; ++i) {
+            export_obj_floats(&writer, "vt", (const f32 *)(mb->texcoords.data + i), 2);
+        }
+
+        for (u32 i = start; i < end; ++i) {
+            export_obj_floats(&writer, "vn", (const f32 *)(mb->normals.data + i), 3);
+        }
+
+        for (u32 i = base; i < base + (end - start); i += 3) {
+            export_obj_face(&writer, i);
+        }
+
+        base += end - start;
+    }
+
+    return export_close(&writer, path);
+}
+
+/* glTF 2.0 binary container. */
+#define EXPORT_GLB_MAGIC    0x46546c67 /* "glTF" */
+#define EXPORT_GLB_VERSION  2
+#define EXPORT_GLB_JSON     0x4e4f534a /* "JSON" */
+#define EXPORT_GLB_BIN      0x004e4942 /* "BIN\0" */
+
+#define EXPORT_GL_BYTE           5120
+#define EXPORT_GL_SHORT          5122
+#define EXPORT_GL_UNSIGNED_SHORT 5123
+#define EXPORT_GL_UNSIGNED_INT   5125
+#define EXPORT_GL_FLOAT          5126
+
+#define EXPORT_GL_ARRAY_BUFFER         34962
+#define EXPORT_GL_ELEMENT_ARRAY_BUFFER 34963
+
+/* Relative tolerance when checking that a view is a transformed copy of
+ * another one.
+ */
+#define EXPORT_GLB_MATCH_EPSILON 1e-5f
+
+typedef dck_stretchy_t (char, u32) export_json_t;
+
+/* One glTF mesh, the welded vertices of the first view that had its shape. */
+typedef struct
+{
+    u32 view;
+
+    u32 vertex_count;
+    u32 index_count;
+
+    Vector3 *positions;
+    Vector3 *normals;
+    Vector2 *texcoords;
+    u32     *indices;
+
+    // quantized positions are stored as (position - center) / scale
+    Vector3 center;
+    f32     scale;
+    b32     texcoords_unorm;
+
+    u64 sizes[4]; // positions, normals, texcoords, indices in the BIN chunk
+} export_glb_mesh_t;
+
+typedef struct
+{
+    u32    mesh;
+    Matrix matrix;
+} export_glb_node_t;
+
+typedef struct
+{
+    u64 hash;
+    u32 vertex_count;
+    u32 view;
+} export_glb_key_t;
+
+static void
+export_json_printf(export_json_t *json, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    i32 len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    dck_stretchy_reserve(*json, (u32)len + 1);
+
+    va_start(args, format);
+    vsnprintf(json->data + json->count, len + 1, format, args);
+    va_end(args);
+
+    json->count += len;
+}
+
+/* Appends `value` in its shortest round trip form. */
+static void
+export_json_f32(export_json_t *json, f32 value)
+{
+    dck_stretchy_reserve(*json, FMT_F32_SIZE);
+    json->count += fmt_f32(json->data + json->count, value);
+}
+
+static int
+export_glb_key_cmp(const void *a, const void *b)
+{
+    const export_glb_key_t *ka = a;
+    const export_glb_key_t *kb = b;
+
+    if (ka->vertex_count != kb->vertex_count)
+        return ka->vertex_count < kb->vertex_count ? -1 : 1;
+
+    if (ka->hash != kb->hash)
+        return ka->hash < kb->hash ? -1 : 1;
+
+    return (ka->view > kb->view) - (ka->view < kb->view);
+}
+
+static inline Matrix
+export_matrix_columns(Vector3 x, Vector3 y, Vector3 z)
+{
+    return (Matrix) {
+        x.x, y.x, z.x, 0.0f,
+        x.y, y.y, z.y, 0.0f,
+        x.z, y.z, z.z, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+}
+
+/* Looks for the affine transform that turns view `a` into view `b` vertex
+ * by vertex, like mb_view_dupe does. Texcoords have to match exactly.
+ */
+static b32
+export_glb_match(mb_t *mb, mb_view_t a, mb_view_t b, Matrix *matrix_o)
+{
+    u32 count = a.vertex_count;
+
+    if (memcmp(mb->texcoords.data + a.vertex_start,
+               mb->texcoords.data + b.vertex_start, count * sizeof(Vector2)))
+        return false;
+
+    const Vector3 *pa = mb->positions.data + a.vertex_start;
+    const Vector3 *pb = mb->positions.data + b.vertex_start;
+
+    // three directions spanning `a`, taken between the same vertices on both sides
+    u32 i1 = 0;
+    f32 best = 0.0f;
+
+    for (u32 i = 1; i < count; ++i) {
+        f32 d = Vector3LengthSqr(Vector3Subtract(pa[i], pa[0]));
+        if (d > best) { best = d; i1 = i; }
+    }
+
+    if (!i1)
+        return false;
+
+    Vector3 a1 = Vector3Subtract(pa[i1], pa[0]);
+
+    u32 i2 = 0;
+    best = 0.0f;
+
+    for (u32 i = 1; i < count; ++i) {
+        f32 d = Vector3LengthSqr(Vector3CrossProduct(a1, Vector3Subtract(pa[i], pa[0])));
+        if (d > best) { best = d; i2 = i; }
+    }
+
+    f32 a1_len = Vector3Length(a1);
+
+    if (!i2 || sqrtf(best) < EXPORT_GLB_MATCH_EPSILON * a1_len * a1_len)
+        return false;
+
+    Vector3 a2 = Vector3Subtract(pa[i2], pa[0]);
+    Vector3 a_up = Vector3Normalize(Vector3CrossProduct(a1, a2));
+
+    u32 i3 = 0;
+    best = 0.0f;
+
+    for (u32 i = 1; i < count; ++i) {
+        f32 d = fabsf(Vector3DotProduct(a_up, Vector3Subtract(pa[i], pa[0])));
+        if (d > best) { best = d; i3 = i; }
+    }
+
+    Vector3 b1 = Vector3Subtract(pb[i1], pb[0]);
+    Vector3 b2 = Vector3Subtract(pb[i2], pb[0]);
+    Vector3 a3, b3;
+
+    if (best > EXPORT_GLB_MATCH_EPSILON * a1_len) {
+        a3 = Vector3Subtract(pa[i3], pa[0]);
+        b3 = Vector3Subtract(pb[i3], pb[0]);
+    }
+    else {
+        // flat view, only similarity transforms can be recovered
+        f32 b1_len = Vector3Length(b1);
+        if (b1_len == 0.0f)
+            return false;
+
+        a3 = Vector3Scale(Vector3CrossProduct(a1, a2), 1.0f / a1_len);
+        b3 = Vector3Scale(Vector3CrossProduct(b1, b2), 1.0f / b1_len);
+    }
+
+    Matrix matrix = MatrixMultiply(MatrixInvert(export_matrix_columns(a1, a2, a3)),
+                                   export_matrix_columns(b1, b2, b3));
+
+    Vector3 origin = Vector3Transform(pa[0], matrix);
+
+    matrix.m12 = pb[0].x - origin.x;
+    matrix.m13 = pb[0].y - origin.y;
+    matrix.m14 = pb[0].z - origin.z;
+
+    f32 tolerance = EXPORT_GLB_MATCH_EPSILON * (Vector3Length(b1) + fabsf(pb[0].x)
+                                                                  + fabsf(pb[0].y)
+                                                                  + fabsf(pb[0].z));
+
+    for (u32 i = 0; i < count; ++i) {
+        Vector3 d = Vector3Subtract(Vector3Transform(pa[i], matrix), pb[i]);
+
+        if (fabsf(d.x) > tolerance || fabsf(d.y) > tolerance || fabsf(d.z) > tolerance)
+            return false;
+    }
+
+    Matrix normal_matrix = MatrixTranspose(MatrixInvert(matrix));
+
+    const Vector3 *na = mb->normals.data + a.vertex_start;
+    const Vector3 *nb = mb->normals.data + b.vertex_start;
+
+    for (u32 i = 0; i < count; ++i) {
+        Vector3 n = Vector3Normalize(Vector3Transform(na[i], normal_matrix));
+
+        if (Vector3DotProduct(n, Vector3Normalize(nb[i])) < 1.0f - EXPORT_GLB_MATCH_EPSILON)
+            return false;
+    }
+
+    *matrix_o = matrix;
+
+    return true;
+}
+
+static inline u64
+export_glb_vertex_hash(Vector3 position, Vector3 normal, Vector2 texcoord)
+{
+    u64 hash = CACHE_HASH_SEED;
+
+    hash = cache_hash(&position, sizeof(position), hash);
+    hash = cache_hash(&normal,   sizeof(normal),   hash);
+    hash = cache_hash(&texcoord, sizeof(texcoord), hash);
+
+    return hash;
+}
+
+/* Merges bitwise identical vertices of the mesh's view into an index list. */
+static void
+export_glb_weld(mb_t *mb, export_glb_mesh_t *mesh, mb_view_t view)
+{
+    u32 count = view.vertex_count / 3 * 3;
+
+    u32 table_size = 16;
+    while (table_size < count * 2) {
+        table_size *= 2;
+    }
+
+    u32 *table = mem_alloc(mem_Io, table_size * sizeof(u32));
+
+    mesh->positions = mem_alloc(mem_Io, count * sizeof(Vector3));
+    mesh->normals   = mem_alloc(mem_Io, count * sizeof(Vector3));
+    mesh->texcoords = mem_alloc(mem_Io, count * sizeof(Vector2));
+    mesh->indices   = mem_alloc(mem_Io, count * sizeof(u32));
+
+    if (!table || !mesh->positions || !mesh->normals || !mesh->texcoords || !mesh->indices) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    memset(table, 0xff, table_size * sizeof(u32));
+
+    u32 unique = 0;
+
+    for (u32 i = 0; i < count; ++i) {
+        Vector3 position = mb->positions.data[view.vertex_start + i];
+        Vector3 normal   = mb->normals.data  [view.vertex_start + i];
+        Vector2 texcoord = mb->texcoords.data[view.vertex_start + i];
+
+        u32 slot = export_glb_vertex_hash(position, normal, texcoord) & (table_size - 1);
+
+        for (;;) {
+            u32 at = table[slot];
+
+            if (at == UINT32_MAX) {
+                table[slot] = unique;
+
+                mesh->positions[unique] = position;
+                mesh->normals  [unique] = normal;
+                mesh->texcoords[unique] = texcoord;
+
+                mesh->indices[i] = unique++;
+                break;
+            }
+
+            if (memcmp(&mesh->positions[at], &position, sizeof(position)) == 0 &&
+                memcmp(&mesh->normals  [at], &normal,   sizeof(normal))   == 0 &&
+                memcmp(&mesh->texcoords[at], &texcoord, sizeof(texcoord)) == 0) {
+                mesh->indices[i] = at;
+                break;
+            }
+
+            slot = (slot + 1) & (table_size - 1);
+        }
+    }
+
+    mem_free(table);
+
+    mesh->vertex_count = unique;
+    mesh->index_count  = count;
+}
+
+static void
+export_bounds(const export_glb_mesh_t *mesh, Vector3 *min_o, Vector3 *max_o)
+{
+    vec3_t min, max;
+    vec3_aabb((const f32 *)mesh->positions, mesh->vertex_count, &min, &max);
+
+    *min_o = mb_vector3(min);
+    *max_o = mb_vector3(max);
+}
+
+static void
+export_glb_layout(export_glb_mesh_t *mesh, u32 flags)
+{
+    u32 n = mesh->vertex_count;
+
+    Vector3 min, max;
+    export_bounds(mesh, &min, &max);
+
+    mesh->texcoords_unorm = true;
+
+    for (u32 i = 0; i < n; ++i) {
+        Vector2 t = mesh->texcoords[i];
+        if (!(t.x >= 0.0f && t.x <= 1.0f && t.y >= 0.0f && t.y <= 1.0f)) {
+            mesh->texcoords_unorm = false;
+        }
+    }
+
+    // one scale for all axes, so normals aren't skewed by the dequantization
+    Vector3 extent = Vector3Scale(Vector3Subtract(max, min), 0.5f);
+    f32 half = fmaxf(extent.x, fmaxf(extent.y, extent.z));
+
+    mesh->center = Vector3Scale(Vector3Add(min, max), 0.5f);
+    mesh->scale  = half > 0.0f ? half / 32767.0f : 1.0f;
+
+    b32 quantize = flags & export_Quantize;
+
+    u64 index_size = n <= UINT16_MAX + 1 ? sizeof(u16) : sizeof(u32);
+
+    mesh->sizes[0] = n * (quantize ? 4 * sizeof(i16) : sizeof(Vector3));
+    mesh->sizes[1] = n * (quantize ? 4 * sizeof(i8)  : sizeof(Vector3));
+    mesh->sizes[2] = n * (quantize && mesh->texcoords_unorm ? 2 * sizeof(u16) : sizeof(Vector2));
+    mesh->sizes[3] = (mesh->index_count * index_size + 3) & ~(u64)3;
+}
+
+static inline i32
+export_quantize(f32 value, f32 limit)
+{
+    f32 q = roundf(value);
+    return (i32)fminf(fmaxf(q, -limit), limit);
+}
+
+static void
+export_glb_json(export_json_t *json, export_glb_mesh_t *meshes, u32 mesh_count,
+                export_glb_node_t *nodes, u32 node_count, u64 bin_size, u32 flags)
+{
+    b32 quantize = flags & export_Quantize;
+
+    export_json_printf(json, "{\"asset\":{\"version\":\"2.0\",\"generator\":\"cad\"},");
+
+    if (quantize) {
+        export_json_printf(json, "\"extensionsUsed\":[\"KHR_mesh_quantization\"],"
+                                 "\"extensionsRequired\":[\"KHR_mesh_quantization\"],");
+    }
+
+    export_json_printf(json, "\"scene\":0,\"scenes\":[{\"nodes\":[");
+    for (u32 i = 0; i < node_count; ++i) {
+        export_json_printf(json, "%s%u", i ? "," : "", i);
+    }
+
+    export_json_printf(json, "]}],\"nodes\":[");
+    for (u32 i = 0; i < node_count; ++i) {
+        export_glb_mesh_t *mesh = meshes + nodes[i].mesh;
+        Matrix matrix = nodes[i].matrix;
+
+        if (quantize) {
+            Matrix dequantize = MatrixMultiply(MatrixScale(mesh->scale, mesh->scale, mesh->scale),
+                                               MatrixTranslate(mesh->center.x, mesh->center.y, mesh->center.z));
+            matrix = MatrixMultiply(dequantize, matrix);
+        }
+
+        f32 m[16] = {
+            matrix.m0,  matrix.m1,  matrix.m2,  matrix.m3,
+            matrix.m4,  matrix.m5,  matrix.m6,  matrix.m7,
+            matrix.m8,  matrix.m9,  matrix.m10, matrix.m11,
+            matrix.m12, matrix.m13, matrix.m14, matrix.m15,
+        };
+
+        export_json_printf(json, "%s{\"mesh\":%u,\"matrix\":[", i ? "," : "", nodes[i].mesh);
+        for (u32 j = 0; j < 16; ++j) {
+            if (j) {
+                export_json_printf(json, ",");
+            }
+            export_json_f32(json, m[j]);
+        }
+        export_json_printf(json, "]}");
+    }
+
+    export_json_printf(json, "],\"meshes\":[");
+    for (u32 i = 0; i < mesh_count; ++i) {
+        u32 a = i * 4;
+        export_json_printf(json, "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%u,\"NORMAL\":%u,"
+                                 "\"TEXCOORD_0\":%u},\"indices\":%u}]}",
+                           i ? "," : "", a, a + 1, a + 2, a + 3);
+    }
+
+    export_json_printf(json, "],\"accessors\":[");
+    for (u32 i = 0; i < mesh_count; ++i) {
+        export_glb_mesh_t *mesh = meshes + i;
+        u32 b = i * 4;
+
+        Vector3 min, max;
+        export_bounds(mesh, &min, &max);
+
+        if (quantize) {
+            min = Vector3Scale(Vector3Subtract(min, mesh->center), 1.0f / mesh->scale);
+            max = Vector3Scale(Vector3Subtract(max, mesh->center), 1.0f / mesh->scale);
+
+            export_json_printf(json, "%s{\"bufferView\":%u,\"componentType\":%u,\"count\":%u,\"type\":\"VEC3\","
+                                     "\"min\":[%d,%d,%d],\"max\":[%d,%d,%d]},",
+                               i ? "," : "", b, EXPORT_GL_SHORT, mesh->vertex_count,
+                               export_quantize(min.x, 32767.0f), export_quantize(min.y, 32767.0f),
+                               export_quantize(min.z, 32767.0f), export_quantize(max.x, 32767.0f),
+                               export_quantize(max.y, 32767.0f), export_quantize(max.z, 32767.0f));
+
+            export_json_printf(json, "{\"bufferView\":%u,\"componentType\":%u,\"normalized\":true,"
+                                     "\"count\":%u,\"type\":\"VEC3\"},",
+                               b + 1, EXPORT_GL_BYTE, mesh->vertex_count);
+        }
+        else {
+            export_json_printf(json, "%s{\"bufferView\":%u,\"componentType\":%u,\"count\":%u,\"type\":\"VEC3\","
+                                     "\"min\":[",
+                               i ? "," : "", b, EXPORT_GL_FLOAT, mesh->vertex_count);
+
+            export_json_f32(json, min.x); export_json_printf(json, ",");
+            export_json_f32(json, min.y); export_json_printf(json, ",");
+            export_json_f32(json, min.z); export_json_printf(json, "],\"max\":[");
+            export_json_f32(json, max.x); export_json_printf(json, ",");
+            export_json_f32(json, max.y); export_json_printf(json, ",");
+            export_json_f32(json, max.z); export_json_printf(json, "]},");
+
+            export_json_printf(json, "{\"bufferView\":%u,\"componentType\":%u,\"count\":%u,\"type\":\"VEC3\"},",
+                               b + 1, EXPORT_GL_FLOAT, mesh->vertex_count);
+        }
+
+        if (quantize && mesh->texcoords_unorm) {
+            export_json_printf(json, "{\"bufferView\":%u,\"componentType\":%u,\"normalized\":true,"
+                                     "\"count\":%u,\"type\":\"VEC2\"},",
+                               b + 2, EXPORT_GL_UNSIGNED_SHORT, mesh->vertex_count);
+        }
+        else {
+            export_json_printf(json, "{\"bufferView\":%u,\"componentType\":%u,\"count\":%u,\"type\":\"VEC2\"},",
+                               b + 2, EXPORT_GL_FLOAT, mesh->vertex_count);
+        }
+
+        export_json_printf(json, "{\"bufferView\":%u,\"componentType\":%u,\"count\":%u,\"type\":\"SCALAR\"}",
+                           b + 3, mesh->vertex_count <= UINT16_MAX + 1 ? EXPORT_GL_UNSIGNED_SHORT
+                                                                       : EXPORT_GL_UNSIGNED_INT,
+                           mesh->index_count);
+    }
+
+    export_json_printf(json, "],\"bufferViews\":[");
+
+    u64 offset = 0;
+
+    for (u32 i = 0; i < mesh_count; ++i) {
+        export_glb_mesh_t *mesh = meshes + i;
+
+        u32 strides[3] = {
+            quantize ? 4 * sizeof(i16) : sizeof(Vector3),
+            quantize ? 4 * sizeof(i8)  : sizeof(Vector3),
+            quantize && mesh->texcoords_unorm ? 2 * sizeof(u16) : sizeof(Vector2),
+        };
+
+        for (u32 j = 0; j < 3; ++j) {
+            export_json_printf(json, "%s{\"buffer\":0,\"byteOffset\":%llu,\"byteLength\":%llu,"
+                                     "\"byteStride\":%u,\"target\":%u}",
+                               i || j ? "," : "", (unsigned long long)offset,
+                               (unsigned long long)mesh->sizes[j], strides[j], EXPORT_GL_ARRAY_BUFFER);
+            offset += mesh->sizes[j];
+        }
+
+        u64 index_size = mesh->vertex_count <= UINT16_MAX + 1 ? sizeof(u16) : sizeof(u32);
+
+        export_json_printf(json, ",{\"buffer\":0,\"byteOffset\":%llu,\"byteLength\":%llu,\"target\":%u}",
+                           (unsigned long long)offset,
+                           (unsigned long long)(mesh->index_count * index_size),
+                           EXPORT_GL_ELEMENT_ARRAY_BUFFER);
+        offset += mesh->sizes[3];
+    }
+
+    export_json_printf(json, "],\"buffers\":[{\"byteLength\":%llu}]}", (unsigned long long)bin_size);
+
+    // chunks are 4 byte aligned, JSON pads with spaces
+    while (json->count % 4) {
+        export_json_printf(json, " ");
+    }
+}
+
+static void
+export_glb_write_mesh(io_writer_t *writer, export_glb_mesh_t *mesh, u32 flags)
+{
+    u32 n = mesh->vertex_count;
+
+    if (!(flags & export_Quantize)) {
+        io_writer_write(writer, mesh->positions, n * sizeof(Vector3));
+        io_writer_write(writer, mesh->normals,   n * sizeof(Vector3));
+        io_writer_write(writer, mesh->texcoords, n * sizeof(Vector2));
+    }
+    else {
+        f32 inv_scale = 1.0f / mesh->scale;
+
+        for (u32 i = 0; i < n; ++i) {
+            Vector3 p = Vector3Scale(Vector3Subtract(mesh->positions[i], mesh->center), inv_scale);
+
+            i16 q[4] = {
+                export_quantize(p.x, 32767.0f),
+                export_quantize(p.y, 32767.0f),
+                export_quantize(p.z, 32767.0f),
+            };
+
+            memcpy(io_writer_reserve(writer, sizeof(q)), q, sizeof(q));
+            io_writer_commit(writer, sizeof(q));
+        }
+
+        for (u32 i = 0; i < n; ++i) {
+            Vector3 normal = Vector3Normalize(mesh->normals[i]);
+
+            i8 q[4] = {
+                export_quantize(normal.x * 127.0f, 127.0f),
+                export_quantize(normal.y * 127.0f, 127.0f),
+                export_quantize(normal.z * 127.0f, 127.0f),
+            };
+
+            memcpy(io_writer_reserve(writer, sizeof(q)), q, sizeof(q));
+            io_writer_commit(writer, sizeof(q));
+        }
+
+        if (mesh->texcoords_unorm) {
+            for (u32 i = 0; i < n; ++i) {
+                u16 q[2] = {
+                    roundf(mesh->texcoords[i].x * 65535.0f),
+                    roundf(mesh->texcoords[i].y * 65535.0f),
+                };
+
+                memcpy(io_writer_reserve(writer, sizeof(q)), q, sizeof(q));
+                io_writer_commit(writer, sizeof(q));
+            }
+        }
+        else {
+            io_writer_write(writer, mesh->texcoords, n * sizeof(Vector2));
+        }
+    }
+
+    if (n <= UINT16_MAX + 1) {
+        for (u32 i = 0; i < mesh->index_count; ++i) {
+            u16 index = mesh->indices[i];
+
+            memcpy(io_writer_reserve(writer, sizeof(index)), &index, sizeof(index));
+            io_writer_commit(writer, sizeof(index));
+        }
+
+        if (mesh->index_count % 2) {
+            u16 padding = 0;
+            io_writer_write(writer, &padding, sizeof(padding));
+        }
+    }
+    else {
+        io_writer_write(writer, mesh->indices, mesh->index_count * sizeof(u32));
+    }
+}
+
+/* Every view becomes a node. Views that are transformed copies of an earlier
+ * one (same vertex count and texcoords, positions and normals related by one
+ * affine transform) share its mesh, vertices within a mesh are welded.
+ */
+b32
+export_glb(const char *path, mb_t *mb, const mb_view_t *views, u32 view_count, u32 flags)
+{
+    mb_view_t all;
+    views = export_views(mb, views, &view_count, &all);
+
+    export_glb_key_t  *keys  = mem_alloc(mem_Io, view_count * sizeof(export_glb_key_t));
+    export_glb_node_t *nodes = mem_alloc(mem_Io, view_count * sizeof(export_glb_node_t));
+
+    if (!keys || !nodes) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    u32 key_count = 0;
+
+    for (u32 i = 0; i < view_count; ++i) {
+        if (views[i].vertex_count < 3)
+            continue;
+
+        keys[key_count++] = (export_glb_key_t) {
+            .hash         = cache_hash(mb->texcoords.data + views[i].vertex_start,
+                                       views[i].vertex_count * sizeof(Vector2), CACHE_HASH_SEED),
+            .vertex_count = views[i].vertex_count,
+            .view         = i,
+        };
+    }
+
+    qsort(keys, key_count, sizeof(*keys), export_glb_key_cmp);
+
+    dck_stretchy_t (export_glb_mesh_t, u32) meshes = {0};
+
+    u32 group_start = 0;
+
+    for (u32 k = 0; k < key_count; ++k) {
+        if (k && (keys[k].hash != keys[k - 1].hash || keys[k].vertex_count != keys[k - 1].vertex_count)) {
+            group_start = meshes.count;
+        }
+
+        mb_view_t view = views[keys[k].view];
+
+        export_glb_node_t node = {
+            .mesh   = UINT32_MAX,
+            .matrix = MatrixIdentity(),
+        };
+
+        for (u32 m = group_start; m < meshes.count; ++m) {
+            if (export_glb_match(mb, views[meshes.data[m].view], view, &node.matrix)) {
+                node.mesh = m;
+                break;
+            }
+        }
+
+        if (node.mesh == UINT32_MAX) {
+            node.mesh = meshes.count;
+            dck_stretchy_push(meshes, (export_glb_mesh_t) { .view = keys[k].view });
+        }
+
+        nodes[keys[k].view] = node;
+    }
+
+    // nodes in view order, skipping the empty ones
+    u32 node_count = 0;
+
+    for (u32 i = 0; i < view_count; ++i) {
+        if (views[i].vertex_count >= 3) {
+            nodes[node_count++] = nodes[i];
+        }
+    }
+
+    u64 bin_size = 0;
+
+    for (u32 m = 0; m < meshes.count; ++m) {
+        export_glb_weld(mb, meshes.data + m, views[meshes.data[m].view]);
+        export_glb_layout(meshes.data + m, flags);
+
+        for (u32 j = 0; j < 4; ++j) {
+            bin_size += meshes.data[m].sizes[j];
+        }
+    }
+
+    export_json_t json = {0};
+    export_glb_json(&json, meshes.data, meshes.count, nodes, node_count, bin_size, flags);
+
+    b32 ok = false;
+    io_writer_t writer;
+
+    if (export_open(&writer, path)) {
+        u32 header[5] = {
+            EXPORT_GLB_MAGIC,
+            EXPORT_GLB_VERSION,
+            (u32)(12 + 8 + json.count + 8 + bin_size),
+            json.count,
+            EXPORT_GLB_JSON,
+        };
+
+        io_writer_write(&writer, header, sizeof(header));
+        io_writer_write(&writer, json.data, json.count);
+
+        u32 bin_header[2] = { (u32)bin_size, EXPORT_GLB_BIN };
+        io_writer_write(&writer, bin_header, sizeof(bin_header));
+
+        for (u32 m = 0; m < meshes.count; ++m) {
+            export_glb_write_mesh(&writer, meshes.data + m, flags);
+        }
+
+        ok = export_close(&writer, path);
+    }
+
+    for (u32 m = 0; m < meshes.count; ++m) {
+        mem_free(meshes.data[m].positions);
+        mem_free(meshes.data[m].normals);
+        mem_free(meshes.data[m].texcoords);
+        mem_free(meshes.data[m].indices);
+    }
+
+    dck_stretchy_free(meshes);
+    dck_stretchy_free(json);
+    mem_free(nodes);
+    mem_free(keys);
+
+    return ok;
+}
+
+/* Picks the format from the extension of `path`, `flags` are export_flags_t. */
+b32
+export_mesh(const char *path, mb_t *mb, const mb_view_t *views, u32 view_count, u32 flags)
+{
+    const char *ext = strrchr(path, '.');
+
+    if (ext && strcasecmp(ext, ".stl") == 0)
+        return export_stl(path, mb, views, view_count);
+
+    if (ext && strcasecmp(ext, ".ply") == 0)
+        return export_ply(path, mb, views, view_count);
+
+    if (ext && strcasecmp(ext, ".obj") == 0)
+        return export_obj(path, mb, views, view_count);
+
+    if (ext && strcasecmp(ext, ".glb") == 0)
+        return export_glb(path, mb, views, view_count, flags);
+
+    fprintf(stderr, "Unknown export format: %s\n", path);
+    return false;
+}
+
+#endif // EXPORT_H_
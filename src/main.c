@@ -1,261 +1,80 @@
 #include "core/utils.h"
+
+// before dck.h and io.h, they include it
+#define MEM_IMPLEMENTATION
+#include "core/mem.h"
+
 #include "core/dck.h"
 
+#define IO_IMPLEMENTATION
+#include "core/io.h"
+
+#define PARSE_IMPLEMENTATION
+#include "core/parse.h"
+
+#define FMT_IMPLEMENTATION
+#include "core/fmt.h"
+
+#define JOBS_IMPLEMENTATION
+#include "core/jobs.h"
+
 #include <raylib.h>
 #include <raymath.h>
 
+#include "mb.h"
+#include "obj.h"
+#include "tex_cache.h"
+#include "shader_cache.h"
+#include "mesh_cache.h"
+#include "export.h"
+#include "prim_cache.h"
+#include "tape.h"
+#include "design.h"
+#include "redraw.h"
+
 #include <math.h>
 #include <string.h>
+#include <time.h>
 
 #define TEX_RES 32
 
 #define UNIT_SCALE  ((Vector3) { 1.0f, 1.0f, 1.0f })
 
-Matrix
+affine_t
 matrix_from(Vector3 position, Vector3 rotation_axis, float rotation_angle, Vector3 scale)
 {
-    Matrix mat_scale       = MatrixScale(scale.x, scale.y, scale.z);
-    Matrix mat_rotation    = MatrixRotate(rotation_axis, rotation_angle * DEG2RAD);
-    Matrix mat_translation = MatrixTranslate(position.x, position.y, position.z);
+    return affine_trs(mb_vec3(position), mb_vec3(rotation_axis), rotation_angle * DEG2RAD, mb_vec3(scale));
+}
+
+/* The 4x4 handed to raylib. Its Matrix names the fields column major but
+ * declares them row by row, so they're set by name.
+ */
+Matrix
+matrix_to_raylib(affine_t affine)
+{
+    const f32 *m = affine.data;
 
-    return MatrixMultiply(MatrixMultiply(mat_scale, mat_rotation), mat_translation);
+    return (Matrix) {
+        .m0 = m[0], .m4 = m[3], .m8  = m[6], .m12 = m[9],
+        .m1 = m[1], .m5 = m[4], .m9  = m[7], .m13 = m[10],
+        .m2 = m[2], .m6 = m[5], .m10 = m[8], .m14 = m[11],
+        .m3 = 0.0f, .m7 = 0.0f, .m11 = 0.0f, .m15 = 1.0f,
+    };
 }
 
 static Material render_mesh_material;
 static i32 render_mesh_normal_matrix_loc;
 
 void
-render_mesh(Mesh mesh, Shader shader, Texture2D texture, Matrix matrix)
+render_mesh(Mesh mesh, Shader shader, Texture2D texture, affine_t matrix)
 {
     render_mesh_material.shader = shader;
     SetMaterialTexture(&render_mesh_material, MATERIAL_MAP_ALBEDO, texture);
 
-    Matrix normal_matrix = MatrixTranspose(MatrixInvert(matrix));
+    Matrix normal_matrix = matrix_to_raylib(affine_normal(matrix));
     SetShaderValueMatrix(shader, render_mesh_normal_matrix_loc, normal_matrix);
 
-    DrawMesh(mesh, render_mesh_material, matrix);
-}
-
-Shader
-load_shader(const char *vertex_path, const char *fragment_path)
-{
-    Shader shader = LoadShader(vertex_path, fragment_path); 
-    if (!IsShaderReady(shader)) {
-        fprintf(stderr, "Failed to loaded shader: (%s, %s)\n", vertex_path, fragment_path);
-        exit(1);
-    }
-    printf("Loaded shader: (%s, %s)\n", vertex_path, fragment_path);
-
-    return shader;
-}
-
-typedef struct
-{
-    dck_stretchy_t (Vector3, u32) positions;
-    dck_stretchy_t (Vector3, u32) normals;
-    dck_stretchy_t (Vector2, u32) texcoords;
-} mb_t;
-
-void
-mb_clear(mb_t *mb)
-{
-    mb->positions.count = 0;
-    mb->normals.count   = 0;
-    mb->texcoords.count = 0;
-}
-
-Mesh
-mb_to_mesh(mb_t *mb)
-{
-    Mesh mesh = {
-        .vertexCount   = mb->positions.count,
-        .triangleCount = mb->positions.count / 3,
-
-        .vertices  = (f32 *)(mb->positions.data),
-        .texcoords = (f32 *)(mb->texcoords.data),
-        .normals   = (f32 *)(mb->normals.data),
-    };
-
-    UploadMesh(&mesh, false);
-
-    return mesh;
-}
-
-void
-mb_vertex(mb_t *mb, Vector3 position, Vector3 normal, Vector2 texcoord)
-{
-    dck_stretchy_push(mb->positions, position);
-    dck_stretchy_push(mb->normals,   normal);
-    dck_stretchy_push(mb->texcoords, texcoord);
-}
-
-typedef struct
-{
-    mb_t *mb;
-
-    Vector3 positions[4];
-    Vector3 normals  [4];
-    Vector2 texcoords[4];
-
-    u32 count;
-
-    u32 vertex_start;
-} mb_strip_t;
-
-mb_strip_t
-mb_strip_create(mb_t *mb)
-{
-    return (mb_strip_t) {
-        .mb           = mb,
-        .vertex_start = mb->positions.count,
-    };
-}
-
-void
-mb_strip_push(mb_strip_t *strip, Vector3 position, Vector3 normal, Vector2 texcoord)
-{
-    strip->positions[strip->count] = position;
-    strip->normals  [strip->count] = normal;
-    strip->texcoords[strip->count] = texcoord;
-
-    strip->count++;
-
-    if (strip->count == 4) {
-        strip->count = 2;
-
-        mb_vertex(strip->mb, strip->positions[0],
-                             strip->normals  [0],
-                             strip->texcoords[0]);
-
-        mb_vertex(strip->mb, strip->positions[1],
-                             strip->normals  [1],
-                             strip->texcoords[1]);
-
-        mb_vertex(strip->mb, strip->positions[2],
-                             strip->normals  [2],
-                             strip->texcoords[2]);
-
-        mb_vertex(strip->mb, strip->positions[3],
-                             strip->normals  [3],
-                             strip->texcoords[3]);
-
-        mb_vertex(strip->mb, strip->positions[2],
-                             strip->normals  [2],
-                             strip->texcoords[2]);
-
-        mb_vertex(strip->mb, strip->positions[1],
-                             strip->normals  [1],
-                             strip->texcoords[1]);
-
-        strip->positions[0] = strip->positions[2];
-        strip->normals  [0] = strip->normals  [2];
-        strip->texcoords[0] = strip->texcoords[2];
-
-        strip->positions[1] = strip->positions[3];
-        strip->normals  [1] = strip->normals  [3];
-        strip->texcoords[1] = strip->texcoords[3];
-    }
-}
-
-void
-mb_strip_reset(mb_strip_t *strip)
-{
-    strip->count = 0;
-}
-
-typedef struct
-{
-    u32 vertex_start;
-    u32 vertex_count;
-} mb_view_t;
-
-mb_view_t
-mb_strip_get_view(mb_strip_t *strip)
-{
-    return (mb_view_t) {
-        .vertex_start = strip->vertex_start,
-        .vertex_count = strip->mb->positions.count - strip->vertex_start,
-    };
-}
-
-mb_view_t
-mb_view_begin(mb_t *mb)
-{
-    return (mb_view_t) {
-        .vertex_start = mb->positions.count,
-    };
-}
-
-mb_view_t
-mb_view_end(mb_t *mb, mb_view_t view)
-{
-    return (mb_view_t) {
-        .vertex_start = view.vertex_start,
-        .vertex_count = mb->positions.count - view.vertex_start,
-    };
-}
-
-mb_view_t
-mb_view_copy(mb_t *mb_dst, mb_t *mb_src, mb_view_t view_src)
-{
-    u32 vertex_start = mb_dst->positions.count;
-
-    dck_stretchy_reserve(mb_dst->positions, view_src.vertex_count);
-    dck_stretchy_reserve(mb_dst->normals,   view_src.vertex_count);
-    dck_stretchy_reserve(mb_dst->texcoords, view_src.vertex_count);
-
-    memcpy(mb_dst->positions.data + mb_dst->positions.count,
-           mb_src->positions.data + view_src.vertex_start,
-           view_src.vertex_count * sizeof(Vector3));
-
-    memcpy(mb_dst->normals.data + mb_dst->positions.count,
-           mb_src->normals.data + view_src.vertex_start,
-           view_src.vertex_count * sizeof(Vector3));
-
-    memcpy(mb_dst->texcoords.data + mb_dst->positions.count,
-           mb_src->texcoords.data + view_src.vertex_start,
-           view_src.vertex_count * sizeof(Vector2));
-
-    mb_dst->positions.count += view_src.vertex_count;
-    mb_dst->normals.count   += view_src.vertex_count;
-    mb_dst->texcoords.count += view_src.vertex_count;
-
-    return (mb_view_t) {
-        .vertex_start = vertex_start,
-        .vertex_count = view_src.vertex_count,
-    };
-}
-
-void
-mb_view_transform(mb_t *mb, mb_view_t view, Matrix matrix)
-{
-    Matrix normal_matrix = MatrixTranspose(MatrixInvert(matrix));
-
-    for (u32 i = view.vertex_start; i < view.vertex_start + view.vertex_count; ++i) {
-        mb->positions.data[i] = Vector3Transform(mb->positions.data[i], matrix);
-        mb->normals.data[i]   = Vector3Transform(mb->normals.data[i], normal_matrix);
-    }
-}
-
-mb_view_t
-mb_view_dupe(mb_t *mb, mb_view_t view, Matrix matrix)
-{
-    mb_view_t new  = mb_view_copy(mb, mb, view);
-    mb_view_transform(mb, new, matrix);
-    return new;
-}
-
-Texture2D
-load_texture(const char *path)
-{
-    Texture2D texture = LoadTexture(path);
-    if (!IsTextureReady(texture)) {
-        fprintf(stderr, "Failed to load texture: %s!\n", path);
-        exit(1);
-    }
-    printf("Loaded texture: %s\n", path);
-
-    return texture;
+    DrawMesh(mesh, render_mesh_material, matrix_to_raylib(matrix));
 }
 
 mb_view_t
@@ -313,8 +132,13 @@ create_face(mb_t *mb, f32 xs, f32 ys)
     return mb_strip_get_view(&strip);
 }
 
+/* Planks come in a few stock sizes, their local geometry is generated once
+ * and copied from here afterwards.
+ */
+prim_cache_t prim_cache = PRIM_CACHE_INIT;
+
 mb_view_t
-create_plank(mb_t *mb, f32 xs, f32 ys, f32 zs)
+create_plank_uncached(mb_t *mb, f32 xs, f32 ys, f32 zs)
 {
     mb_view_t view = mb_view_begin(mb);
 
@@ -353,7 +177,23 @@ create_plank(mb_t *mb, f32 xs, f32 ys, f32 zs)
 }
 
 mb_view_t
-create_plank_angled(mb_t *mb, f32 xs, f32 ys, f32 zs, f32 a1, f32 a2)
+create_plank(mb_t *mb, f32 xs, f32 ys, f32 zs)
+{
+    prim_cache_key_t key = prim_cache_key(design_Plank, (f32[]) { xs, ys, zs }, 3);
+
+    mb_view_t view;
+
+    if (prim_cache_copy(&prim_cache, key, mb, &view))
+        return view;
+
+    view = create_plank_uncached(mb, xs, ys, zs);
+    prim_cache_store(&prim_cache, key, mb, view);
+
+    return view;
+}
+
+mb_view_t
+create_plank_angled_uncached(mb_t *mb, f32 xs, f32 ys, f32 zs, f32 a1, f32 a2)
 {
     mb_view_t view = mb_view_begin(mb);
 
@@ -470,70 +310,106 @@ create_plank_angled(mb_t *mb, f32 xs, f32 ys, f32 zs, f32 a1, f32 a2)
 }
 
 mb_view_t
-create_wall(mb_t *mb)
+create_plank_angled(mb_t *mb, f32 xs, f32 ys, f32 zs, f32 a1, f32 a2)
 {
-    f32 lw = 0.12f;
-    f32 sw = 0.06f;
+    prim_cache_key_t key = prim_cache_key(design_Angled, (f32[]) { xs, ys, zs, a1, a2 }, 5);
+
+    mb_view_t view;
 
-    f32 height = 2.0f;
-    f32 width  = 1.5f - lw * 2.0f;
+    if (prim_cache_copy(&prim_cache, key, mb, &view))
+        return view;
 
-    mb_view_t full = mb_view_begin(mb);
+    view = create_plank_angled_uncached(mb, xs, ys, zs, a1, a2);
+    prim_cache_store(&prim_cache, key, mb, view);
+
+    return view;
+}
+
+mb_view_t
+design_emit_primitive(mb_t *mb, u32 kind, const f32 *args)
+{
+    if (kind == design_Angled)
+        return create_plank_angled(mb, args[0], args[1], args[2], args[3], args[4]);
 
-    mb_view_t side = mb_view_begin(mb);
+    return create_plank(mb, args[0], args[1], args[2]);
+}
+
+/* Hashed into the mesh cache key, keep it free of padding. */
+typedef struct
+{
+    f32 lw;
+    f32 sw;
+
+    f32 height;
+    f32 width;
+} wall_params_t;
+
+/* Records the wall on `tape`, every plank is flagged as a part. */
+void
+wall_tape(tape_t *tape, wall_params_t params)
+{
+    f32 lw = params.lw;
+    f32 sw = params.sw;
+
+    f32 height = params.height;
+    f32 width  = params.width - lw * 2.0f;
+
+    u32 full = tape_begin(tape);
+
+    u32 side = tape_begin(tape);
     {
-        mb_view_t plank = create_plank(mb, height, lw, sw);
-        mb_view_transform(mb, plank, matrix_from(
+        u32 plank = tape_emit(tape, design_Plank, (f32[]) { height, lw, sw }, 3, tape_Part);
+        tape_transform(tape, plank, matrix_from(
             (Vector3) { lw,   0.0f, 0.0f },
             (Vector3) { 0.0f, 0.0f, 1.0f }, 90.0f,
             (Vector3) { 1.0f, 1.0f, 1.0f }
         ));
 
-        mb_view_dupe(mb, plank, matrix_from(
+        tape_dupe(tape, plank, matrix_from(
             (Vector3) { 0.0f, 0.0f, -(lw + sw) },
             (Vector3) { 0.0f, 1.0f,  0.0f }, 0.0f,
             (Vector3) { 1.0f, 1.0f,  1.0f }
         ));
 
-        mb_view_t plank_middle = create_plank(mb, height - 2.0f * (lw - sw), sw, lw);
-        mb_view_transform(mb, plank_middle, matrix_from(
+        u32 plank_middle = tape_emit(tape, design_Plank, (f32[]) { height - 2.0f * (lw - sw), sw, lw }, 3, tape_Part);
+        tape_transform(tape, plank_middle, matrix_from(
             (Vector3) { lw, (lw - sw), -sw },
             (Vector3) { 0.0f,  0.0f, 1.0f }, 90.0f,
             (Vector3) { 1.0f,  1.0f, 1.0f }
         ));
     }
-    side = mb_view_end(mb, side);
+    tape_end(tape, side);
 
-    mb_view_dupe(mb, side, matrix_from(
+    tape_dupe(tape, side, matrix_from(
         (Vector3) { width + (lw * 2.0f), 0.0f, -(lw + 2.0f * sw) },
         (Vector3) { 0.0f, 1.0f, 0.0f }, 180.0f,
         (Vector3) { 1.0f, 1.0f, 1.0f }
     ));
 
-    mb_view_t bottom = mb_view_begin(mb);
+    u32 bottom = tape_begin(tape);
     {
-        mb_view_t plank = create_plank(mb, width, lw, sw);
-        mb_view_transform(mb, plank, matrix_from(
+        u32 plank = tape_emit(tape, design_Plank, (f32[]) { width, lw, sw }, 3, tape_Part);
+        tape_transform(tape, plank, matrix_from(
             (Vector3) { lw,   0.0f, 0.0f },
             (Vector3) { 0.0f, 1.0f, 0.0f }, 0.0f,
             (Vector3) { 1.0f, 1.0f, 1.0f }
         ));
 
-        mb_view_dupe(mb, plank, matrix_from(
+        tape_dupe(tape, plank, matrix_from(
             (Vector3) { 0.0f, lw - sw, -(sw + lw) },
             (Vector3) { 1.0f, 0.0f, 0.0f }, 90.0f,
             (Vector3) { 1.0f, 1.0f, 1.0f }
         ));
 
-        mb_view_dupe(mb, plank, matrix_from(
+        tape_dupe(tape, plank, matrix_from(
             (Vector3) { 0.0f, 0.0f, -(sw + lw) },
             (Vector3) { 0.0f, 1.0f, 0.0f }, 0.0f,
             (Vector3) { 1.0f, 1.0f, 1.0f }
         ));
     }
-    bottom = mb_view_end(mb, bottom);
+    tape_end(tape, bottom);
 
-    mb_view_dupe(mb, bottom, matrix_from(
+    tape_dupe(tape, bottom, matrix_from(
         (Vector3) { 0.0f, height, -(lw + 2.0f * sw) },
         (Vector3) { 1.0f, 0.0f,   0.0f }, 180.0f,
         (Vector3) { 1.0f, 1.0f,   1.0f }
@@ -542,59 +418,469 @@ create_wall(mb_t *mb)
     f32 angled_width  = width / 4.0f;
     f32 angled_length = sqrtf(angled_width * angled_width * 2.0f);
 
-    mb_view_t angleds = mb_view_begin(mb);
+    u32 angleds = tape_begin(tape);
     {
         f32 inset = -(sw + (lw - sw) * 0.5f);
 
-        mb_view_t angled = create_plank_angled(mb, angled_length, lw, sw, 45.0f, 45.0f);
-        mb_view_transform(mb, angled, matrix_from(
+        u32 angled = tape_emit(tape, design_Angled, (f32[]) { angled_length, lw, sw, 45.0f, 45.0f }, 5, tape_Part);
+        tape_transform(tape, angled, matrix_from(
             (Vector3) { lw + angled_width, lw, inset },
             (Vector3) { 0.0f,              0.0f, 1.0f }, 90.0f + 45.0f,
             (Vector3) { 1.0f,              1.0f, 1.0f }
         ));
 
-        angled = create_plank_angled(mb, angled_length, lw, sw, 45.0f, 45.0f);
-        mb_view_transform(mb, angled, matrix_from(
+        angled = tape_emit(tape, design_Angled, (f32[]) { angled_length, lw, sw, 45.0f, 45.0f }, 5, tape_Part);
+        tape_transform(tape, angled, matrix_from(
             (Vector3) { lw,   height - lw - angled_width, inset },
             (Vector3) { 0.0f, 0.0f, 1.0f }, 45.0f,
             (Vector3) { 1.0f, 1.0f, 1.0f }
         ));
     }
-    angleds = mb_view_end(mb, angleds);
-    mb_view_dupe(mb, angleds, matrix_from(
+    tape_end(tape, angleds);
+
+    tape_dupe(tape, angleds, matrix_from(
         (Vector3) { width + lw * 2.0f, 0.0f, -(lw + sw * 2.0f) },
         (Vector3) { 0.0f, 1.0f, 0.0f }, 180.0f,
         (Vector3) { 1.0f, 1.0f, 1.0f }
     ));
 
-    return mb_view_end(mb, full);
+    tape_end(tape, full);
+}
+
+/* Every plank that ends up in the wall is recorded in `parts`, unless it's
+ * NULL.
+ */
+mb_view_t
+create_wall(mb_t *mb, wall_params_t params, mb_views_t *parts)
+{
+    tape_t tape = {0};
+    wall_tape(&tape, params);
+
+    mb_view_t wall = tape_run(&tape, mb, parts, design_emit_primitive, NULL);
+
+    tape_free(&tape);
+
+    return wall;
+}
+
+/* Seconds on a monotonic clock, usable before raylib's timer exists. */
+f64
+startup_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Startup assets are loaded in two steps. Everything that doesn't need GL
+ * (file IO, decoding, baking, mesh generation) runs as a job on the pool while
+ * the window opens. The GL side of each one (uploads, program linking) runs
+ * on the main thread in the `_finish` functions, which wait for their job.
+ */
+
+typedef struct
+{
+    jobs_done_t done;
+
+    const char *path;
+    b32 ok;
+
+    tex_cache_pending_t pending;
+} texture_job_t;
+
+void
+texture_job_run(void *arg)
+{
+    texture_job_t *job = arg;
+    job->ok = tex_cache_prepare(job->path, tex_cache_Compress, &job->pending);
+}
+
+/* Uploads a prepared texture, exits when it couldn't be loaded. */
+Texture2D
+texture_job_upload(texture_job_t *job)
+{
+    Texture2D texture = {0};
+
+    if (job->ok) {
+        texture = tex_cache_finish(&job->pending);
+    }
+
+    if (!IsTextureReady(texture)) {
+        fprintf(stderr, "Failed to load texture: %s!\n", job->path);
+        exit(1);
+    }
+    printf("Loaded texture: %s\n", job->path);
+
+    return texture;
+}
+
+Texture2D
+texture_job_finish(jobs_t *jobs, texture_job_t *job)
+{
+    jobs_wait(jobs, &job->done);
+    return texture_job_upload(job);
+}
+
+typedef struct
+{
+    jobs_done_t done;
+
+    const char *vertex_path;
+    const char *fragment_path;
+    b32 ok;
+
+    shader_cache_pending_t pending;
+} shader_job_t;
+
+void
+shader_job_run(void *arg)
+{
+    shader_job_t *job = arg;
+    job->ok = shader_cache_prepare(job->vertex_path, job->fragment_path, &job->pending);
+}
+
+Shader
+shader_job_finish(jobs_t *jobs, shader_job_t *job)
+{
+    jobs_wait(jobs, &job->done);
+
+    Shader shader;
+
+    if (!job->ok || !shader_cache_finish(&job->pending, &shader)) {
+        fprintf(stderr, "Failed to loaded shader: (%s, %s)\n", job->vertex_path, job->fragment_path);
+        exit(1);
+    }
+    printf("Loaded shader: (%s, %s)\n", job->vertex_path, job->fragment_path);
+
+    return shader;
+}
+
+typedef struct
+{
+    jobs_done_t done;
+
+    wall_params_t params;
+
+    mesh_cache_t cache; // header is NULL when the wall was built into `mb`
+    mb_t mb;
+} wall_job_t;
+
+void
+wall_job_run(void *arg)
+{
+    wall_job_t *job = arg;
+
+    u64 key = mesh_cache_key("create_wall", &job->params, sizeof(job->params));
+
+    if (mesh_cache_open("wall", key, &job->cache))
+        return;
+
+    mem_tag_t tag = mem_tag_set(mem_Mesh);
+
+    mb_view_t wall = create_wall(&job->mb, job->params, NULL);
+    mesh_cache_store("wall", key, &job->mb, &wall, 1, NULL, 0);
+
+    mem_tag_set(tag);
+}
+
+Mesh
+wall_job_finish(jobs_t *jobs, wall_job_t *job)
+{
+    jobs_wait(jobs, &job->done);
+
+    Mesh mesh;
+
+    if (job->cache.header) {
+        b32 uploaded = mesh_cache_to_mesh(&job->cache, &mesh);
+        mesh_cache_close(&job->cache);
+
+        if (uploaded)
+            return mesh;
+
+        mem_tag_t tag = mem_tag_set(mem_Mesh);
+        create_wall(&job->mb, job->params, NULL);
+        mem_tag_set(tag);
+    }
+
+    return mb_to_mesh(&job->mb);
+}
+
+typedef struct
+{
+    jobs_done_t done;
+
+    const char *path;
+    jobs_t *jobs;
+    b32 ok;
+
+    design_model_t model;
+} design_job_t;
+
+void
+design_job_run(void *arg)
+{
+    design_job_t *job = arg;
+
+    design_t design;
+    job->ok = design_load(job->path, &design);
+
+    if (!job->ok)
+        return;
+
+    mem_tag_t tag = mem_tag_set(mem_Mesh);
+    design_build(&design, NULL, design_emit_primitive, job->jobs, &job->model);
+    mem_tag_set(tag);
+
+    design_free(&design);
+}
+
+Mesh
+design_job_finish(jobs_t *jobs, design_job_t *job)
+{
+    jobs_wait(jobs, &job->done);
+
+    if (!job->ok) {
+        exit(1);
+    }
+    printf("Loaded design: %s (%u parts)\n", job->path, job->model.parts.count);
+
+    return mb_to_mesh(&job->model.mb);
+}
+
+/* Rebuilds `model` from the design at `path`, regenerating only the parts
+ * that changed, and replaces `mesh`. Both are kept when the design is broken.
+ */
+void
+design_reload(const char *path, jobs_t *jobs, design_model_t *model, Mesh *mesh)
+{
+    f64 start = startup_time();
+
+    design_t design;
+
+    if (!design_load(path, &design)) {
+        fprintf(stderr, "Failed to reload design: %s, keeping the previous one\n", path);
+        return;
+    }
+
+    design_model_t rebuilt;
+
+    mem_tag_t tag = mem_tag_set(mem_Mesh);
+    design_build(&design, model, design_emit_primitive, jobs, &rebuilt);
+    mem_tag_set(tag);
+
+    design_free(&design);
+
+    mb_unload_mesh(*mesh);
+    *mesh = mb_to_mesh(&rebuilt.mb);
+
+    design_model_free(model);
+    *model = rebuilt;
+
+    printf("Reloaded design: %s (%u parts, %u reused, %u generated) in %.1f ms\n", path,
+           model->parts.count, model->reused, model->generated, (startup_time() - start) * 1000.0);
+}
+
+typedef struct
+{
+    jobs_done_t done;
+
+    const char *path;
+    jobs_t *jobs;
+    b32 ok;
+
+    mb_t  mb;
+    obj_t obj;
+
+    texture_job_t texture; // diffuse map of the first group, path is NULL without one
+} model_job_t;
+
+void
+model_job_run(void *arg)
+{
+    model_job_t *job = arg;
+
+    mem_tag_t tag = mem_tag_set(mem_Mesh);
+    job->ok = obj_load(&job->mb, job->path, job->jobs, &job->obj);
+    mem_tag_set(tag);
+
+    if (!job->ok)
+        return;
+
+    obj_t *obj = &job->obj;
+
+    if (obj->groups.count && obj->groups.data[0].material != OBJ_NO_MATERIAL) {
+        obj_material_t *material = obj->materials.data + obj->groups.data[0].material;
+
+        if (material->diffuse_map) {
+            job->texture.path = material->diffuse_map;
+            texture_job_run(&job->texture);
+        }
+    }
+}
+
+/* Uploads the model, and its texture if it has one, `*texture_o` is left
+ * alone otherwise.
+ */
+Mesh
+model_job_finish(jobs_t *jobs, model_job_t *job, Texture2D *texture_o)
+{
+    jobs_wait(jobs, &job->done);
+
+    if (!job->ok) {
+        exit(1);
+    }
+    printf("Loaded model: %s (%u vertices)\n", job->path, job->obj.view.vertex_count);
+
+    Mesh mesh = mb_to_mesh(&job->mb);
+
+    if (job->texture.path) {
+        *texture_o = texture_job_upload(&job->texture);
+    }
+
+    obj_free(&job->obj);
+
+    return mesh;
 }
 
 i32
-main(void)
+main(i32 argc, char *argv[])
 {
+    f64 start_time = startup_time();
+
+    b32 continuous = false;
+
+    const char *export_path  = NULL;
+    u32         export_flags = export_None;
+
+    const char *design_path  = NULL;
+    const char *model_path   = NULL;
+
+    for (i32 i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "continuous") == 0) {
+            continuous = true;
+        }
+        else if (strcmp(argv[i], "export") == 0 && i + 1 < argc) {
+            export_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "quantize") == 0) {
+            export_flags |= export_Quantize;
+        }
+        else if (strcmp(argv[i], "design") == 0 && i + 1 < argc) {
+            design_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "model") == 0 && i + 1 < argc) {
+            model_path = argv[++i];
+        }
+    }
+
+    wall_params_t wall_params = {
+        .lw     = 0.12f,
+        .sw     = 0.06f,
+        .height = 2.0f,
+        .width  = 1.5f,
+    };
+
+    if (export_path) {
+        mb_t export_mb = {0};
+        mb_views_t parts = {0};
+
+        mem_tag_set(mem_Mesh);
+
+        // a design replaces the built-in wall, as in the viewer
+        if (design_path) {
+            design_t design;
+
+            if (!design_load(design_path, &design))
+                return 1;
+
+            design_model_t model;
+            design_build(&design, NULL, design_emit_primitive, NULL, &model);
+            design_free(&design);
+
+            dck_stretchy_for (model.parts, design_part_t, part) {
+                mb_views_push(&parts, part->view);
+            }
+
+            export_mb = model.mb;
+            dck_stretchy_free(model.parts);
+        }
+        else {
+            create_wall(&export_mb, wall_params, &parts);
+        }
+
+        return export_mesh(export_path, &export_mb, parts.data, parts.count, export_flags) ? 0 : 1;
+    }
+
+    jobs_t jobs;
+
+    if (!jobs_init(&jobs, 0)) {
+        fprintf(stderr, "Failed to start the job pool\n");
+        return 1;
+    }
+
+    texture_job_t texture_job = { .path = "res/wood_100.png" };
+    shader_job_t  shader_job  = {
+        .vertex_path   = "res/shaders/based.vert.glsl",
+        .fragment_path = "res/shaders/based.frag.glsl",
+    };
+    wall_job_t    wall_job    = { .params = wall_params };
+    design_job_t  design_job  = { .path = design_path, .jobs = &jobs };
+    model_job_t   model_job   = { .path = model_path, .jobs = &jobs };
+
+    // a model is the slowest, it goes first so it isn't left for last
+    if (model_path) {
+        jobs_push(&jobs, model_job_run, &model_job, &model_job.done);
+    }
+
+    jobs_push(&jobs, shader_job_run,  &shader_job,  &shader_job.done);
+    jobs_push(&jobs, texture_job_run, &texture_job, &texture_job.done);
+
+    // a design replaces the built-in wall
+    if (design_path) {
+        jobs_push(&jobs, design_job_run, &design_job, &design_job.done);
+    }
+    else {
+        jobs_push(&jobs, wall_job_run, &wall_job, &wall_job.done);
+    }
+
     SetTraceLogLevel(LOG_WARNING);
 
     InitWindow(1920, 1080, "CAD");
     SetTargetFPS(60);
 
-    render_mesh_material = LoadMaterialDefault();
+    redraw_t redraw;
+    redraw_init(&redraw, continuous);
 
-    Texture2D texture = load_texture("res/wood_100.png");
+    render_mesh_material = LoadMaterialDefault();
 
-    Shader based_shader = load_shader("res/shaders/based.vert.glsl",
-                                      "res/shaders/based.frag.glsl");
+    Shader based_shader = shader_job_finish(&jobs, &shader_job);
     render_mesh_normal_matrix_loc = GetShaderLocation(based_shader, "normalMatrix");
 
-    f32 angle = 0.0f;
+    shader_watch_t based_watch = shader_watch_create(shader_job.vertex_path,
+                                                     shader_job.fragment_path,
+                                                     based_shader);
+
+    Texture2D texture = texture_job_finish(&jobs, &texture_job);
 
-    mb_t mb = {0};
+    Mesh mesh = design_path ? design_job_finish(&jobs, &design_job)
+                            : wall_job_finish(&jobs, &wall_job);
 
-    create_wall(&mb);
+    design_watch_t design_watch = {0};
 
-    Mesh mesh = mb_to_mesh(&mb);
+    if (design_path) {
+        design_watch = design_watch_create(design_path);
+    }
 
-    mb_clear(&mb);
+    // an OBJ given with `model` is shown next to the wall
+    Texture2D model_texture = texture;
+    Mesh model_mesh = {0};
+
+    if (model_path) {
+        model_mesh = model_job_finish(&jobs, &model_job, &model_texture);
+    }
+
+    f32 angle = 0.0f;
 
     Camera3D camera = {
         .position   = { 0.0f, 0.0f, 0.0f },
@@ -611,11 +897,36 @@ main(void)
     b32 floating     = false;
     u32 move_timeout = 0;
 
+    b32 focused = IsWindowFocused();
+
     while (!WindowShouldClose()) {
         if (IsKeyPressed(KEY_Q))
             break;
 
-        dt = GetFrameTime();
+        if (shader_watch_poll(&based_watch)) {
+            based_shader = based_watch.shader;
+            render_mesh_normal_matrix_loc = GetShaderLocation(based_shader, "normalMatrix");
+            redraw_request(&redraw);
+        }
+
+        if (design_path && design_watch_poll(&design_watch)) {
+            design_reload(design_path, &jobs, &design_job.model, &mesh);
+            redraw_request(&redraw);
+        }
+
+        if (IsKeyPressed(KEY_C)) {
+            redraw.continuous = !redraw.continuous;
+        }
+
+        if (IsWindowResized() || IsWindowFocused() != (bool)focused) {
+            focused = IsWindowFocused();
+            redraw_request(&redraw);
+        }
+
+        Vector3 last_position = camera.position;
+        Vector3 last_target   = camera.target;
+
+        dt = redraw_frame_time(&redraw);
 
         angle += dt * 60.0f;
 
@@ -683,6 +994,24 @@ main(void)
             camera.target = Vector3Add(camera.position, view_dir);
         }
 
+        if (memcmp(&last_position, &camera.position, sizeof(Vector3))
+         || memcmp(&last_target,   &camera.target,   sizeof(Vector3))) {
+            redraw_request(&redraw);
+        }
+
+        b32 animating = move_timeout > 0 || (floating && (IsKeyDown(KEY_W) || IsKeyDown(KEY_S)
+                                                       || IsKeyDown(KEY_A) || IsKeyDown(KEY_D)
+                                                       || IsKeyDown(KEY_SPACE)
+                                                       || IsKeyDown(KEY_LEFT_SHIFT)));
+
+        if (!redraw_begin(&redraw, animating)) {
+            redraw_skip(&redraw);
+            continue;
+        }
+
+        // nothing on this thread allocates while drawing, MEM_TRACK builds check it
+        mem_forbid_begin();
+
         BeginDrawing();
             ClearBackground(GRAY);
 
@@ -691,13 +1020,34 @@ main(void)
                 Vector3 rotation_axis = { 0.0f, 1.0f, 0.0f };
                 Vector3 scale         = { 1.0f, 1.0f, 1.0f };
 
-                Matrix matrix = matrix_from(position, rotation_axis, 0.0f, scale);
+                affine_t matrix = matrix_from(position, rotation_axis, 0.0f, scale);
                 render_mesh(mesh, based_shader, texture, matrix);
+
+                if (model_path) {
+                    affine_t model_matrix = matrix_from((Vector3) { 3.0f, 0.0f, -5.0f }, rotation_axis, 0.0f, scale);
+                    render_mesh(model_mesh, based_shader, model_texture, model_matrix);
+                }
             EndMode3D();
 
         EndDrawing();
+
+        mem_forbid_end();
+
+        if (start_time > 0.0) {
+            printf("First frame after %.1f ms\n", (startup_time() - start_time) * 1000.0);
+            start_time = 0.0;
+        }
     }
 
+    redraw_destroy(&redraw);
+
+#if MEM_TRACK
+    mem_report(stdout);
+#endif
+
+    // design reloads run on the pool, it lives as long as the window
+    jobs_destroy(&jobs);
+
     CloseWindow();
 
     return 0;
@@ -0,0 +1,425 @@
+#ifndef MB_H_
+#define MB_H_
+
+/* Mesh builder.
+ *
+ * Unindexed triangle lists kept as separate position, normal and texcoord
+ * arrays. Views are ranges of vertices that can be copied, transformed and
+ * duplicated after they were emitted.
+ */
+
+#include "core/utils.h"
+#include "core/dck.h"
+#include "core/lina.h"
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct
+{
+    dck_stretchy_t (Vector3, u32) positions;
+    dck_stretchy_t (Vector3, u32) normals;
+    dck_stretchy_t (Vector2, u32) texcoords;
+} mb_t;
+
+void
+mb_clear(mb_t *mb)
+{
+    mb->positions.count = 0;
+    mb->normals.count   = 0;
+    mb->texcoords.count = 0;
+}
+
+void
+mb_free(mb_t *mb)
+{
+    dck_stretchy_free(mb->positions);
+    dck_stretchy_free(mb->normals);
+    dck_stretchy_free(mb->texcoords);
+
+    *mb = (mb_t) {0};
+}
+
+Mesh
+mb_to_mesh(mb_t *mb)
+{
+    Mesh mesh = {
+        .vertexCount   = mb->positions.count,
+        .triangleCount = mb->positions.count / 3,
+
+        .vertices  = (f32 *)(mb->positions.data),
+        .texcoords = (f32 *)(mb->texcoords.data),
+        .normals   = (f32 *)(mb->normals.data),
+    };
+
+    UploadMesh(&mesh, false);
+
+    return mesh;
+}
+
+/* Releases the GPU side of a mesh from `mb_to_mesh`, the vertex data belongs
+ * to the mb.
+ */
+void
+mb_unload_mesh(Mesh mesh)
+{
+    mesh.vertices  = NULL;
+    mesh.texcoords = NULL;
+    mesh.normals   = NULL;
+
+    UnloadMesh(mesh);
+}
+
+void
+mb_vertex(mb_t *mb, Vector3 position, Vector3 normal, Vector2 texcoord)
+{
+    dck_stretchy_push(mb->positions, position);
+    dck_stretchy_push(mb->normals,   normal);
+    dck_stretchy_push(mb->texcoords, texcoord);
+}
+
+typedef struct
+{
+    mb_t *mb;
+
+    Vector3 positions[4];
+    Vector3 normals  [4];
+    Vector2 texcoords[4];
+
+    u32 count;
+
+    u32 vertex_start;
+} mb_strip_t;
+
+mb_strip_t
+mb_strip_create(mb_t *mb)
+{
+    return (mb_strip_t) {
+        .mb           = mb,
+        .vertex_start = mb->positions.count,
+    };
+}
+
+void
+mb_strip_push(mb_strip_t *strip, Vector3 position, Vector3 normal, Vector2 texcoord)
+{
+    strip->positions[strip->count] = position;
+    strip->normals  [strip->count] = normal;
+    strip->texcoords[strip->count] = texcoord;
+
+    strip->count++;
+
+    if (strip->count == 4) {
+        strip->count = 2;
+
+        mb_vertex(strip->mb, strip->positions[0],
+                             strip->normals  [0],
+                             strip->texcoords[0]);
+
+        mb_vertex(strip->mb, strip->positions[1],
+                             strip->normals  [1],
+                             strip->texcoords[1]);
+
+        mb_vertex(strip->mb, strip->positions[2],
+                             strip->normals  [2],
+                             strip->texcoords[2]);
+
+        mb_vertex(strip->mb, strip->positions[3],
+                             strip->normals  [3],
+                             strip->texcoords[3]);
+
+        mb_vertex(strip->mb, strip->positions[2],
+                             strip->normals  [2],
+                             strip->texcoords[2]);
+
+        mb_vertex(strip->mb, strip->positions[1],
+                             strip->normals  [1],
+                             strip->texcoords[1]);
+
+        strip->positions[0] = strip->positions[2];
+        strip->normals  [0] = strip->normals  [2];
+        strip->texcoords[0] = strip->texcoords[2];
+
+        strip->positions[1] = strip->positions[3];
+        strip->normals  [1] = strip->normals  [3];
+        strip->texcoords[1] = strip->texcoords[3];
+    }
+}
+
+void
+mb_strip_reset(mb_strip_t *strip)
+{
+    strip->count = 0;
+}
+
+typedef struct
+{
+    u32 vertex_start;
+    u32 vertex_count;
+} mb_view_t;
+
+typedef dck_stretchy_t (mb_view_t, u32) mb_views_t;
+
+/* Appends `view` to `views`, which may be NULL when nobody records them. */
+static inline void
+mb_views_push(mb_views_t *views, mb_view_t view)
+{
+    if (views) {
+        dck_stretchy_push(*views, view);
+    }
+}
+
+/* Records the copies of every view of `views` that lies inside `src`, after
+ * `src` was duplicated into `dst`.
+ */
+void
+mb_views_dupe(mb_views_t *views, mb_view_t src, mb_view_t dst)
+{
+    if (!views)
+        return;
+
+    u32 count = views->count;
+
+    for (u32 i = 0; i < count; ++i) {
+        mb_view_t view = views->data[i];
+
+        if (view.vertex_start >= src.vertex_start &&
+            view.vertex_start + view.vertex_count <= src.vertex_start + src.vertex_count) {
+            view.vertex_start = view.vertex_start - src.vertex_start + dst.vertex_start;
+            dck_stretchy_push(*views, view);
+        }
+    }
+}
+
+mb_view_t
+mb_strip_get_view(mb_strip_t *strip)
+{
+    return (mb_view_t) {
+        .vertex_start = strip->vertex_start,
+        .vertex_count = strip->mb->positions.count - strip->vertex_start,
+    };
+}
+
+mb_view_t
+mb_view_begin(mb_t *mb)
+{
+    return (mb_view_t) {
+        .vertex_start = mb->positions.count,
+    };
+}
+
+mb_view_t
+mb_view_end(mb_t *mb, mb_view_t view)
+{
+    return (mb_view_t) {
+        .vertex_start = view.vertex_start,
+        .vertex_count = mb->positions.count - view.vertex_start,
+    };
+}
+
+mb_view_t
+mb_view_copy(mb_t *mb_dst, mb_t *mb_src, mb_view_t view_src)
+{
+    u32 vertex_start = mb_dst->positions.count;
+
+    dck_stretchy_reserve(mb_dst->positions, view_src.vertex_count);
+    dck_stretchy_reserve(mb_dst->normals,   view_src.vertex_count);
+    dck_stretchy_reserve(mb_dst->texcoords, view_src.vertex_count);
+
+    memcpy(mb_dst->positions.data + mb_dst->positions.count,
+           mb_src->positions.data + view_src.vertex_start,
+           view_src.vertex_count * sizeof(Vector3));
+
+    memcpy(mb_dst->normals.data + mb_dst->positions.count,
+           mb_src->normals.data + view_src.vertex_start,
+           view_src.vertex_count * sizeof(Vector3));
+
+    memcpy(mb_dst->texcoords.data + mb_dst->positions.count,
+           mb_src->texcoords.data + view_src.vertex_start,
+           view_src.vertex_count * sizeof(Vector2));
+
+    mb_dst->positions.count += view_src.vertex_count;
+    mb_dst->normals.count   += view_src.vertex_count;
+    mb_dst->texcoords.count += view_src.vertex_count;
+
+    return (mb_view_t) {
+        .vertex_start = vertex_start,
+        .vertex_count = view_src.vertex_count,
+    };
+}
+
+static inline vec3_t
+mb_vec3(Vector3 v)
+{
+    return (vec3_t) { .x = v.x, .y = v.y, .z = v.z };
+}
+
+static inline Vector3
+mb_vector3(vec3_t v)
+{
+    return (Vector3) { v.x, v.y, v.z };
+}
+
+void
+mb_view_transform(mb_t *mb, mb_view_t view, affine_t matrix)
+{
+    int axes[3];
+
+    // quarter turns, flips and axis scales: every output axis is one scaled
+    // input axis, and the normals get the inverse scales
+    if (affine_axes(matrix, axes)) {
+        f32 scale[3];
+        f32 inv_scale[3];
+
+        for (int i = 0; i < 3; ++i) {
+            scale[i]     = matrix.data[axes[i] * 3 + i];
+            inv_scale[i] = 1.0f / scale[i];
+        }
+
+        const f32 *t = matrix.data + 9;
+
+        for (u32 i = view.vertex_start; i < view.vertex_start + view.vertex_count; ++i) {
+            f32 p[3] = { mb->positions.data[i].x, mb->positions.data[i].y, mb->positions.data[i].z };
+            f32 n[3] = { mb->normals.data[i].x,   mb->normals.data[i].y,   mb->normals.data[i].z };
+
+            mb->positions.data[i] = (Vector3) {
+                scale[0] * p[axes[0]] + t[0],
+                scale[1] * p[axes[1]] + t[1],
+                scale[2] * p[axes[2]] + t[2],
+            };
+
+            mb->normals.data[i] = (Vector3) {
+                inv_scale[0] * n[axes[0]],
+                inv_scale[1] * n[axes[1]],
+                inv_scale[2] * n[axes[2]],
+            };
+        }
+
+        return;
+    }
+
+    affine_t normal_matrix = affine_normal(matrix);
+
+    for (u32 i = view.vertex_start; i < view.vertex_start + view.vertex_count; ++i) {
+        mb->positions.data[i] = mb_vector3(affine_point(matrix, mb_vec3(mb->positions.data[i])));
+        mb->normals.data[i]   = mb_vector3(affine_vector(normal_matrix, mb_vec3(mb->normals.data[i])));
+    }
+}
+
+mb_view_t
+mb_view_dupe(mb_t *mb, mb_view_t view, affine_t matrix)
+{
+    mb_view_t new  = mb_view_copy(mb, mb, view);
+    mb_view_transform(mb, new, matrix);
+    return new;
+}
+
+/* Shared appends.
+ *
+ * Between mb_shared_begin and mb_shared_end any number of threads claim
+ * ranges of a presized mb with one fetch-add each and fill them in without
+ * locks, e.g. with mb_vertex_at or by copying a private scratch mb in with
+ * mb_shared_copy. Ranges are laid out in claim order, not call order, so
+ * whoever needs a deterministic layout (tapes) keeps merging in order.
+ *
+ * Nothing else may touch the mb until mb_shared_end.
+ */
+typedef struct
+{
+    mb_t *mb;
+    u32 end;
+
+    // 64 bits so claims that don't fit can't wrap it back below `end`
+    atomic_uint_least64_t next;
+    atomic_uint_least64_t failed; // lowest start of a claim that didn't fit
+} mb_shared_t;
+
+/* Makes room for `vertex_count` more vertices to be claimed. */
+void
+mb_shared_begin(mb_shared_t *shared, mb_t *mb, u32 vertex_count)
+{
+    dck_stretchy_reserve(mb->positions, vertex_count);
+    dck_stretchy_reserve(mb->normals,   vertex_count);
+    dck_stretchy_reserve(mb->texcoords, vertex_count);
+
+    shared->mb  = mb;
+    shared->end = mb->positions.count + vertex_count;
+
+    atomic_init(&shared->next,   mb->positions.count);
+    atomic_init(&shared->failed, shared->end);
+}
+
+/* Claims `vertex_count` consecutive vertices, they have to be written before
+ * mb_shared_end. Returns false when they don't fit in what was reserved.
+ */
+b32
+mb_shared_claim(mb_shared_t *shared, u32 vertex_count, mb_view_t *view_o)
+{
+    u64 start = atomic_fetch_add_explicit(&shared->next, vertex_count, memory_order_relaxed);
+
+    if (start + vertex_count <= shared->end) {
+        *view_o = (mb_view_t) { (u32)start, vertex_count };
+        return true;
+    }
+
+    // every claim below the lowest failed start fit, that's where the mb ends
+    u64 failed = atomic_load_explicit(&shared->failed, memory_order_relaxed);
+
+    while (start < failed && !atomic_compare_exchange_weak_explicit(&shared->failed, &failed, start,
+                                                                    memory_order_relaxed,
+                                                                    memory_order_relaxed)) { }
+
+    return false;
+}
+
+static inline void
+mb_vertex_at(mb_t *mb, u32 index, Vector3 position, Vector3 normal, Vector2 texcoord)
+{
+    mb->positions.data[index] = position;
+    mb->normals.data  [index] = normal;
+    mb->texcoords.data[index] = texcoord;
+}
+
+/* Claims room for `view` of `src` and copies it over. */
+b32
+mb_shared_copy(mb_shared_t *shared, mb_t *src, mb_view_t view, mb_view_t *view_o)
+{
+    if (!mb_shared_claim(shared, view.vertex_count, view_o))
+        return false;
+
+    mb_t *mb = shared->mb;
+    u32 at = view_o->vertex_start;
+
+    memcpy(mb->positions.data + at, src->positions.data + view.vertex_start, view.vertex_count * sizeof(Vector3));
+    memcpy(mb->normals.data   + at, src->normals.data   + view.vertex_start, view.vertex_count * sizeof(Vector3));
+    memcpy(mb->texcoords.data + at, src->texcoords.data + view.vertex_start, view.vertex_count * sizeof(Vector2));
+
+    return true;
+}
+
+/* Takes the claimed vertices into the mb's count, once all writers are done
+ * (joining them orders their writes before this). Returns the view of them.
+ */
+mb_view_t
+mb_shared_end(mb_shared_t *shared)
+{
+    mb_t *mb = shared->mb;
+
+    u64 next   = atomic_load(&shared->next);
+    u64 failed = atomic_load(&shared->failed);
+
+    u32 end = (u32)(next < failed ? next : failed);
+
+    mb_view_t view = { mb->positions.count, end - mb->positions.count };
+
+    mb->positions.count = end;
+    mb->normals.count   = end;
+    mb->texcoords.count = end;
+
+    return view;
+}
+
+#endif // MB_H_
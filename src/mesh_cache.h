@@ -0,0 +1,331 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+/* Generated mesh cache.
+ *
+ * Geometry built by the generators is stored in `CACHE_DIR` after the first
+ * run and mapped on later ones. An entry is identified by a key hashed from
+ * the generator name, its parameters and the code version, so changing either
+ * the inputs or the generator code builds a fresh entry.
+ *
+ * The file is laid out to be used in place: a header, the views, and the
+ * position, normal, texcoord and (optional) u32 index arrays. The header only
+ * holds byte offsets from the start of the file, no pointers, so a mapped
+ * entry is valid wherever it lands.
+ */
+
+#include "core/utils.h"
+#include "core/io.h"
+
+#include "cache.h"
+#include "mb.h"
+
+#include <raylib.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#define MESH_CACHE_MAGIC     0x48534d42 /* "BMSH" */
+#define MESH_CACHE_VERSION   1
+#define MESH_CACHE_EXT       ".bmsh"
+#define MESH_CACHE_ALIGN     16
+
+/* Mixed into every key. Bump it whenever a change to the generators changes
+ * what they output, entries from older versions then stop matching.
+ */
+#define MESH_CACHE_CODE_VERSION 1
+
+typedef struct
+{
+    u64 offset;
+    u64 count;
+} mesh_cache_range_t;
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+
+    u64 key;
+
+    mesh_cache_range_t views;     // mb_view_t
+    mesh_cache_range_t positions; // Vector3
+    mesh_cache_range_t normals;   // Vector3
+    mesh_cache_range_t texcoords; // Vector2
+    mesh_cache_range_t indices;   // u32, count 0 for unindexed meshes
+} mesh_cache_header_t;
+
+typedef struct
+{
+    io_map_t map;
+
+    const mesh_cache_header_t *header;
+} mesh_cache_t;
+
+
+/* `params` is hashed bytewise, pass a struct without padding. */
+static inline u64
+mesh_cache_key(const char *generator, const void *params, size_t params_size)
+{
+    u64 key = CACHE_HASH_SEED;
+
+    key = cache_hash(generator, strlen(generator) + 1, key);
+    key = cache_hash(params, params_size, key);
+    u32 code_version = MESH_CACHE_CODE_VERSION;
+    key = cache_hash(&code_version, sizeof(code_version), key);
+
+    return key;
+}
+
+static inline u64
+mesh_cache_align(u64 offset)
+{
+    return (offset + MESH_CACHE_ALIGN - 1) & ~(u64)(MESH_CACHE_ALIGN - 1);
+}
+
+static inline b32
+mesh_cache_range_valid(mesh_cache_range_t range, u64 element_size, u64 file_size)
+{
+    if (range.offset % MESH_CACHE_ALIGN)
+        return false;
+
+    if (range.offset > file_size)
+        return false;
+
+    return range.count <= (file_size - range.offset) / element_size;
+}
+
+b32
+mesh_cache_header_valid(const mesh_cache_header_t *header, u64 file_size, u64 key)
+{
+    if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION)
+        return false;
+
+    if (header->key != key)
+        return false;
+
+    if (header->positions.count != header->normals.count ||
+        header->positions.count != header->texcoords.count ||
+        header->positions.count > UINT32_MAX)
+        return false;
+
+    return mesh_cache_range_valid(header->views,     sizeof(mb_view_t), file_size)
+        && mesh_cache_range_valid(header->positions, sizeof(Vector3),   file_size)
+        && mesh_cache_range_valid(header->normals,   sizeof(Vector3),   file_size)
+        && mesh_cache_range_valid(header->texcoords, sizeof(Vector2),   file_size)
+        && mesh_cache_range_valid(header->indices,   sizeof(u32),       file_size);
+}
+
+/* Maps the entry `name` if it exists and was built for `key`. The arrays
+ * stay valid until `mesh_cache_close`.
+ */
+b32
+mesh_cache_open(const char *name, u64 key, mesh_cache_t *cache_o)
+{
+    *cache_o = (mesh_cache_t) {0};
+
+    char *entry_path = cache_path(name, MESH_CACHE_EXT);
+
+    io_map_t map;
+    b32 has_entry = io_map_file(entry_path, io_map_WillNeed, &map);
+
+    free(entry_path);
+
+    if (!has_entry)
+        return false;
+
+    const mesh_cache_header_t *header = (const mesh_cache_header_t *)map.begin;
+
+    if (io_map_size(map) < sizeof(*header) ||
+        !mesh_cache_header_valid(header, io_map_size(map), key)) {
+        io_unmap_file(&map);
+        return false;
+    }
+
+    *cache_o = (mesh_cache_t) {
+        .map    = map,
+        .header = header,
+    };
+
+    return true;
+}
+
+void
+mesh_cache_close(mesh_cache_t *cache)
+{
+    io_unmap_file(&cache->map);
+    *cache = (mesh_cache_t) {0};
+}
+
+static inline u32
+mesh_cache_vertex_count(const mesh_cache_t *cache)
+{
+    return (u32)cache->header->positions.count;
+}
+
+static inline u32
+mesh_cache_view_count(const mesh_cache_t *cache)
+{
+    return (u32)cache->header->views.count;
+}
+
+static inline u32
+mesh_cache_index_count(const mesh_cache_t *cache)
+{
+    return (u32)cache->header->indices.count;
+}
+
+static inline const mb_view_t *
+mesh_cache_views(const mesh_cache_t *cache)
+{
+    return (const mb_view_t *)(cache->map.begin + cache->header->views.offset);
+}
+
+static inline const Vector3 *
+mesh_cache_positions(const mesh_cache_t *cache)
+{
+    return (const Vector3 *)(cache->map.begin + cache->header->positions.offset);
+}
+
+static inline const Vector3 *
+mesh_cache_normals(const mesh_cache_t *cache)
+{
+    return (const Vector3 *)(cache->map.begin + cache->header->normals.offset);
+}
+
+static inline const Vector2 *
+mesh_cache_texcoords(const mesh_cache_t *cache)
+{
+    return (const Vector2 *)(cache->map.begin + cache->header->texcoords.offset);
+}
+
+static inline const u32 *
+mesh_cache_indices(const mesh_cache_t *cache)
+{
+    return (const u32 *)(cache->map.begin + cache->header->indices.offset);
+}
+
+/* Uploads the mapped arrays directly. The returned mesh holds no CPU side
+ * data, the entry can be closed right after. Indexed entries need to fit
+ * raylib's 16 bit indices.
+ */
+b32
+mesh_cache_to_mesh(const mesh_cache_t *cache, Mesh *mesh_o)
+{
+    u32 vertex_count = mesh_cache_vertex_count(cache);
+    u32 index_count  = mesh_cache_index_count(cache);
+
+    u16 *indices = NULL;
+
+    if (index_count) {
+        if (vertex_count > UINT16_MAX + 1) {
+            fprintf(stderr, "Cached mesh has %u vertices, too many for 16 bit indices\n", vertex_count);
+            return false;
+        }
+
+        indices = mem_alloc(mem_Cache, index_count * sizeof(u16));
+        if (!indices) {
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+            exit(666);
+        }
+
+        const u32 *src = mesh_cache_indices(cache);
+
+        for (u32 i = 0; i < index_count; ++i) {
+            indices[i] = (u16)src[i];
+        }
+    }
+
+    Mesh mesh = {
+        .vertexCount   = vertex_count,
+        .triangleCount = (index_count ? index_count : vertex_count) / 3,
+
+        .vertices  = (f32 *)mesh_cache_positions(cache),
+        .texcoords = (f32 *)mesh_cache_texcoords(cache),
+        .normals   = (f32 *)mesh_cache_normals(cache),
+        .indices   = indices,
+    };
+
+    UploadMesh(&mesh, false);
+
+    mem_free(indices);
+
+    mesh.vertices  = NULL;
+    mesh.texcoords = NULL;
+    mesh.normals   = NULL;
+    mesh.indices   = NULL;
+
+    *mesh_o = mesh;
+
+    return true;
+}
+
+/* Stores all of `mb` together with `views` and optional `indices` as the
+ * entry `name` for `key`.
+ */
+b32
+mesh_cache_store(const char *name, u64 key, mb_t *mb,
+                 const mb_view_t *views, u32 view_count,
+                 const u32 *indices, u32 index_count)
+{
+    u64 vertex_count = mb->positions.count;
+
+    mesh_cache_header_t header = {
+        .magic   = MESH_CACHE_MAGIC,
+        .version = MESH_CACHE_VERSION,
+        .key     = key,
+    };
+
+    // the header is a multiple of MESH_CACHE_ALIGN, the first array follows directly
+    u64 offset = sizeof(header);
+
+    header.views     = (mesh_cache_range_t) { offset, view_count };
+    offset = mesh_cache_align(offset + view_count * sizeof(mb_view_t));
+
+    header.positions = (mesh_cache_range_t) { offset, vertex_count };
+    offset = mesh_cache_align(offset + vertex_count * sizeof(Vector3));
+
+    header.normals   = (mesh_cache_range_t) { offset, vertex_count };
+    offset = mesh_cache_align(offset + vertex_count * sizeof(Vector3));
+
+    header.texcoords = (mesh_cache_range_t) { offset, vertex_count };
+    offset = mesh_cache_align(offset + vertex_count * sizeof(Vector2));
+
+    header.indices   = (mesh_cache_range_t) { offset, index_count };
+    offset = mesh_cache_align(offset + index_count * sizeof(u32));
+
+    // everything after the header, offsets still count from the file start
+    u64 body_start = sizeof(header);
+    u64 body_size  = offset - body_start;
+
+    u8 *body = mem_calloc(mem_Cache, 1, body_size ? body_size : 1);
+    if (!body) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    if (view_count) {
+        memcpy(body + header.views.offset - body_start, views, view_count * sizeof(mb_view_t));
+    }
+
+    if (vertex_count) {
+        memcpy(body + header.positions.offset - body_start, mb->positions.data, vertex_count * sizeof(Vector3));
+        memcpy(body + header.normals.offset   - body_start, mb->normals.data,   vertex_count * sizeof(Vector3));
+        memcpy(body + header.texcoords.offset - body_start, mb->texcoords.data, vertex_count * sizeof(Vector2));
+    }
+
+    if (index_count) {
+        memcpy(body + header.indices.offset - body_start, indices, index_count * sizeof(u32));
+    }
+
+    char *entry_path = cache_path(name, MESH_CACHE_EXT);
+
+    b32 ok = cache_write(entry_path, &header, sizeof(header), body, body_size);
+
+    free(entry_path);
+    mem_free(body);
+
+    return ok;
+}
+
+#endif // MESH_CACHE_H_
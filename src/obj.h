@@ -0,0 +1,675 @@
+#ifndef OBJ_H_
+#define OBJ_H_
+
+/* Wavefront OBJ/MTL importer.
+ *
+ * The OBJ file is mapped and cut into line aligned chunks that are processed
+ * in three passes, each running its chunks on the job pool:
+ *
+ *   1. parse  - every chunk collects its own v/vt/vn records and fan
+ *               triangulated face corners,
+ *   2. gather - chunk attribute arrays are copied into global ones at offsets
+ *               known from a prefix sum over the chunk counts,
+ *   3. emit   - corners are resolved and written straight into a presized
+ *               range of the `mb_t`, again at prefix summed offsets.
+ *
+ * Negative (relative) indices are stored relative to the chunk in pass 1 and
+ * rebased in pass 3, so no chunk has to know about the ones before it while
+ * parsing. MTL files are small and parsed serially.
+ */
+
+#include "core/utils.h"
+#include "core/dck.h"
+#include "core/io.h"
+#include "core/jobs.h"
+#include "core/parse.h"
+#include "core/sv.h"
+
+#include "mb.h"
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#define OBJ_MAX_CHUNKS      64
+#define OBJ_MIN_CHUNK_SIZE  (256 * 1024)
+
+#define OBJ_NO_MATERIAL     ((u32)-1)
+#define OBJ_NO_INDEX        (-1)
+
+typedef struct
+{
+    char *name;
+    Vector3 diffuse;
+    char *diffuse_map; // path relative to the working directory, or NULL
+} obj_material_t;
+
+typedef struct
+{
+    u32 material;
+    mb_view_t view;
+} obj_group_t;
+
+typedef struct
+{
+    mb_view_t view;
+
+    dck_stretchy_t (obj_material_t, u32) materials;
+    dck_stretchy_t (obj_group_t,    u32) groups;
+
+    u32 errors;
+} obj_t;
+
+typedef enum
+{
+    obj_rel_V  = (1 << 0),
+    obj_rel_Vt = (1 << 1),
+    obj_rel_Vn = (1 << 2),
+} obj_rel_t;
+
+/* 0 based indices, relative ones are relative to the start of the chunk. */
+typedef struct
+{
+    i32 v, vt, vn;
+    u32 rel;
+} obj_corner_t;
+
+typedef struct
+{
+    u32 triangle;
+    sv_t name;
+} obj_switch_t;
+
+typedef struct
+{
+    char *begin, *end;
+
+    // segmented, parsing never moves what's there and gather copies it once
+    dck_segmented_t (Vector3) positions;
+    dck_segmented_t (Vector3) normals;
+    dck_segmented_t (Vector2) texcoords;
+
+    dck_stretchy_t (obj_corner_t, u32) corners;
+    dck_stretchy_t (obj_switch_t, u32) switches;
+    dck_stretchy_t (sv_t,         u32) mtllibs;
+
+    u32 errors;
+
+    /* filled in between the passes */
+    u32 position_start;
+    u32 normal_start;
+    u32 texcoord_start;
+    u32 vertex_start;
+} obj_chunk_t;
+
+typedef struct
+{
+    obj_chunk_t *chunks;
+    u32 chunk_count;
+
+    Vector3 *positions;
+    Vector3 *normals;
+    Vector2 *texcoords;
+
+    u32 position_count;
+    u32 normal_count;
+    u32 texcoord_count;
+
+    mb_t *mb;
+
+    jobs_t *jobs; // NULL runs every chunk on the calling thread
+} obj_job_t;
+
+typedef struct
+{
+    jobs_done_t done;
+
+    obj_job_t *job;
+    u32 chunk;
+    void (*pass)(obj_job_t *job, obj_chunk_t *chunk);
+
+    mem_tag_t tag; // of the thread running the pass
+} obj_task_t;
+
+
+static inline b32
+obj_keyword(sv_t line, const char *keyword, sv_t *rest_o)
+{
+    size_t len = strlen(keyword);
+
+    if (sv_length(line) < len || memcmp(line.begin, keyword, len) != 0)
+        return false;
+
+    if (sv_length(line) > len && !is_space(line.begin[len]))
+        return false;
+
+    *rest_o = (sv_t) { line.begin + len, line.end };
+    return true;
+}
+
+/* Parses up to `count` floats, returns how many were there. */
+static inline u32
+obj_parse_floats(sv_t sv, f32 *out, u32 count)
+{
+    char *next;
+    return (u32)parse_floats_n(sv.begin, sv.end, out, count, &next);
+}
+
+/* Parses one `v`, `v/vt`, `v//vn` or `v/vt/vn` face vertex.
+ * Returns false when there's no vertex left on the line.
+ */
+static inline b32
+obj_parse_corner(char **at, char *end, u32 counts[3], obj_corner_t *corner)
+{
+    parse_triplet_t triplet;
+    char *next;
+
+    *corner = (obj_corner_t) { OBJ_NO_INDEX, OBJ_NO_INDEX, OBJ_NO_INDEX, 0 };
+
+    while (*at < end && is_space(**at)) {
+        ++*at;
+    }
+
+    if (*at == end)
+        return false;
+
+    // a malformed vertex is reported as one without a position
+    if (!parse_index_triplet(*at, end, &triplet, &next))
+        return true;
+
+    *at = next;
+
+    i32 values[3] = { triplet.v, triplet.vt, triplet.vn };
+    i32 *fields[3] = { &corner->v, &corner->vt, &corner->vn };
+
+    for (u32 i = 0; i < 3; ++i) {
+        if (values[i] > 0) {
+            *fields[i] = values[i] - 1;
+        }
+        else if (values[i] < 0) {
+            *fields[i] = (i32)counts[i] + values[i];
+            corner->rel |= 1u << i;
+        }
+    }
+
+    return true;
+}
+
+void
+obj_parse_line(obj_chunk_t *chunk, sv_t line)
+{
+    sv_t rest;
+    f32 values[3] = {0};
+
+    if (obj_keyword(line, "v", &rest)) {
+        if (obj_parse_floats(rest, values, 3) != 3) {
+            ++chunk->errors;
+        }
+
+        dck_segmented_push(chunk->positions, (Vector3) { values[0], values[1], values[2] });
+    }
+    else if (obj_keyword(line, "vt", &rest)) {
+        values[1] = 0.0f;
+
+        if (obj_parse_floats(rest, values, 2) == 0) {
+            ++chunk->errors;
+            values[0] = 0.0f;
+        }
+
+        dck_segmented_push(chunk->texcoords, (Vector2) { values[0], values[1] });
+    }
+    else if (obj_keyword(line, "vn", &rest)) {
+        if (obj_parse_floats(rest, values, 3) != 3) {
+            ++chunk->errors;
+        }
+
+        dck_segmented_push(chunk->normals, (Vector3) { values[0], values[1], values[2] });
+    }
+    else if (obj_keyword(line, "f", &rest)) {
+        u32 counts[3] = {
+            (u32)chunk->positions.count, (u32)chunk->texcoords.count, (u32)chunk->normals.count
+        };
+
+        obj_corner_t first = {0}, prev = {0}, corner;
+        u32 corner_count = 0;
+
+        char *at = rest.begin;
+
+        while (obj_parse_corner(&at, rest.end, counts, &corner)) {
+            if (corner.v == OBJ_NO_INDEX && !(corner.rel & obj_rel_V)) {
+                ++chunk->errors;
+                return;
+            }
+
+            if (corner_count == 0) {
+                first = corner;
+            }
+            else if (corner_count >= 2) {
+                dck_stretchy_push(chunk->corners, first);
+                dck_stretchy_push(chunk->corners, prev);
+                dck_stretchy_push(chunk->corners, corner);
+            }
+
+            prev = corner;
+            ++corner_count;
+        }
+
+        if (corner_count < 3) {
+            ++chunk->errors;
+        }
+    }
+    else if (obj_keyword(line, "usemtl", &rest)) {
+        dck_stretchy_push(chunk->switches, (obj_switch_t) {
+            .triangle = chunk->corners.count / 3,
+            .name     = sv_trim(rest),
+        });
+    }
+    else if (obj_keyword(line, "mtllib", &rest)) {
+        dck_stretchy_push(chunk->mtllibs, sv_trim(rest));
+    }
+}
+
+void
+obj_pass_parse(obj_job_t *job, obj_chunk_t *chunk)
+{
+    (void)job;
+
+    sv_lines_t lines = sv_split_lines((sv_t) { chunk->begin, chunk->end });
+    sv_t line;
+
+    while (sv_next_line(&lines, &line)) {
+        line = sv_trim_left(line);
+
+        if (!sv_empty(line) && *line.begin != '#') {
+            obj_parse_line(chunk, line);
+        }
+    }
+}
+
+void
+obj_pass_gather(obj_job_t *job, obj_chunk_t *chunk)
+{
+    dck_segmented_gather(chunk->positions, job->positions + chunk->position_start,
+                         0, chunk->positions.count);
+    dck_segmented_gather(chunk->normals, job->normals + chunk->normal_start,
+                         0, chunk->normals.count);
+    dck_segmented_gather(chunk->texcoords, job->texcoords + chunk->texcoord_start,
+                         0, chunk->texcoords.count);
+}
+
+void
+obj_pass_emit(obj_job_t *job, obj_chunk_t *chunk)
+{
+    Vector3 *positions = job->mb->positions.data + chunk->vertex_start;
+    Vector3 *normals   = job->mb->normals.data   + chunk->vertex_start;
+    Vector2 *texcoords = job->mb->texcoords.data + chunk->vertex_start;
+
+    for (u32 t = 0; t < chunk->corners.count; t += 3) {
+        b32 has_normals = true;
+
+        for (u32 k = 0; k < 3; ++k) {
+            obj_corner_t c = chunk->corners.data[t + k];
+
+            i64 v  = c.v  + ((c.rel & obj_rel_V)  ? chunk->position_start : 0);
+            i64 vt = c.vt + ((c.rel & obj_rel_Vt) ? chunk->texcoord_start : 0);
+            i64 vn = c.vn + ((c.rel & obj_rel_Vn) ? chunk->normal_start   : 0);
+
+            if (v >= 0 && v < job->position_count) {
+                positions[t + k] = job->positions[v];
+            }
+            else {
+                positions[t + k] = (Vector3) {0};
+                ++chunk->errors;
+            }
+
+            if (vt >= 0 && vt < job->texcoord_count) {
+                texcoords[t + k] = job->texcoords[vt];
+            }
+            else {
+                texcoords[t + k] = (Vector2) {0};
+                chunk->errors += c.vt != OBJ_NO_INDEX || (c.rel & obj_rel_Vt);
+            }
+
+            if (vn >= 0 && vn < job->normal_count) {
+                normals[t + k] = job->normals[vn];
+            }
+            else {
+                has_normals = false;
+                chunk->errors += c.vn != OBJ_NO_INDEX || (c.rel & obj_rel_Vn);
+            }
+        }
+
+        if (!has_normals) {
+            Vector3 normal = Vector3Normalize(Vector3CrossProduct(
+                Vector3Subtract(positions[t + 1], positions[t]),
+                Vector3Subtract(positions[t + 2], positions[t])
+            ));
+
+            normals[t]     = normal;
+            normals[t + 1] = normal;
+            normals[t + 2] = normal;
+        }
+    }
+}
+
+void
+obj_task_run(void *arg)
+{
+    obj_task_t *task = arg;
+
+    mem_tag_t tag = mem_tag_set(task->tag);
+    task->pass(task->job, task->job->chunks + task->chunk);
+    mem_tag_set(tag);
+}
+
+void
+obj_run_pass(obj_job_t *job, void (*pass)(obj_job_t *job, obj_chunk_t *chunk))
+{
+    obj_task_t tasks[OBJ_MAX_CHUNKS];
+
+    // the calling thread takes the first chunk itself, and whatever is still
+    // queued while it waits
+    for (u32 i = 1; i < job->chunk_count && job->jobs; ++i) {
+        tasks[i] = (obj_task_t) { .job = job, .chunk = i, .pass = pass, .tag = mem_tag() };
+        jobs_push(job->jobs, obj_task_run, &tasks[i], &tasks[i].done);
+    }
+
+    for (u32 i = 0; i < job->chunk_count; ++i) {
+        if (i == 0 || !job->jobs) {
+            pass(job, job->chunks + i);
+        }
+        else {
+            jobs_wait(job->jobs, &tasks[i].done);
+        }
+    }
+}
+
+/* Path of `name` relative to the directory of `base`, unless it's absolute. */
+char *
+obj_sibling_path(const char *base, sv_t name)
+{
+    const char *slash = strrchr(base, '/');
+    size_t dir_len  = slash ? (size_t)(slash - base) + 1 : 0;
+
+    if (!sv_empty(name) && name.begin[0] == '/') {
+        dir_len = 0;
+    }
+    size_t name_len = sv_length(name);
+
+    char *path = malloc(dir_len + name_len + 1);
+    if (!path) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    memcpy(path, base, dir_len);
+    memcpy(path + dir_len, name.begin, name_len);
+    path[dir_len + name_len] = '\0';
+
+    return path;
+}
+
+static inline char *
+obj_strdup(sv_t sv)
+{
+    char *str = malloc(sv_length(sv) + 1);
+    if (!str) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    memcpy(str, sv.begin, sv_length(sv));
+    str[sv_length(sv)] = '\0';
+
+    return str;
+}
+
+/* Appends the materials of the MTL file at `path` to `obj`. */
+b32
+obj_load_mtl(obj_t *obj, const char *path)
+{
+    size_t size;
+    char *data = (char *)io_read_file(path, &size);
+
+    if (!data) {
+        fprintf(stderr, "Failed to read material library: %s\n", path);
+        return false;
+    }
+
+    obj_material_t *material = NULL;
+
+    sv_lines_t lines = sv_split_lines((sv_t) { data, data + size });
+    sv_t line;
+
+    while (sv_next_line(&lines, &line)) {
+        line = sv_trim(line);
+        sv_t rest;
+
+        if (obj_keyword(line, "newmtl", &rest)) {
+            dck_stretchy_push(obj->materials, (obj_material_t) {
+                .name    = obj_strdup(sv_trim(rest)),
+                .diffuse = { 1.0f, 1.0f, 1.0f },
+            });
+
+            material = obj->materials.data + obj->materials.count - 1;
+        }
+        else if (material && obj_keyword(line, "Kd", &rest)) {
+            f32 kd[3];
+
+            if (obj_parse_floats(rest, kd, 3) == 3) {
+                material->diffuse = (Vector3) { kd[0], kd[1], kd[2] };
+            }
+        }
+        else if (material && obj_keyword(line, "map_Kd", &rest)) {
+            free(material->diffuse_map);
+            material->diffuse_map = obj_sibling_path(path, sv_trim(rest));
+        }
+    }
+
+    mem_free(data);
+
+    return true;
+}
+
+u32
+obj_find_material(obj_t *obj, sv_t name)
+{
+    for (u32 i = 0; i < obj->materials.count; ++i) {
+        if (sv_is(name, obj->materials.data[i].name))
+            return i;
+    }
+
+    return OBJ_NO_MATERIAL;
+}
+
+void
+obj_free(obj_t *obj)
+{
+    dck_stretchy_for (obj->materials, obj_material_t, material) {
+        free(material->name);
+        free(material->diffuse_map);
+    }
+
+    dck_stretchy_free(obj->materials);
+    dck_stretchy_free(obj->groups);
+
+    *obj = (obj_t) {0};
+}
+
+void
+obj_chunk_free(obj_chunk_t *chunk)
+{
+    dck_segmented_free(chunk->positions);
+    dck_segmented_free(chunk->normals);
+    dck_segmented_free(chunk->texcoords);
+    dck_stretchy_free(chunk->corners);
+    dck_stretchy_free(chunk->switches);
+    dck_stretchy_free(chunk->mtllibs);
+}
+
+/* Appends the triangles of the OBJ file at `path` to `mb`, `obj_o` receives
+ * the materials and per material views. Returns false if the file can't be
+ * read, malformed records are skipped and counted in `obj_o->errors`.
+ * `jobs` may be NULL to parse everything on the calling thread.
+ */
+b32
+obj_load(mb_t *mb, const char *path, jobs_t *jobs, obj_t *obj_o)
+{
+    *obj_o = (obj_t) {0};
+
+    io_map_t map;
+    if (!io_map_file(path, io_map_Sequential | io_map_WillNeed, &map)) {
+        fprintf(stderr, "Failed to open OBJ file: %s\n", path);
+        return false;
+    }
+
+    char *data = map.begin;
+    size_t size = io_map_size(map);
+
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    u32 chunk_count = size / OBJ_MIN_CHUNK_SIZE + 1;
+    if (cpu_count > 0 && chunk_count > (u32)cpu_count) {
+        chunk_count = cpu_count;
+    }
+    if (chunk_count > OBJ_MAX_CHUNKS) {
+        chunk_count = OBJ_MAX_CHUNKS;
+    }
+
+    obj_chunk_t chunks[OBJ_MAX_CHUNKS] = {0};
+
+    obj_job_t job = {
+        .chunks = chunks,
+        .mb     = mb,
+        .jobs   = jobs,
+    };
+
+    // cut at the first line end after every even split point
+    char *at  = data;
+    char *end = data + size;
+
+    for (u32 i = 0; i < chunk_count && at < end; ++i) {
+        char *split = end;
+
+        if (i + 1 < chunk_count) {
+            split = data + size / chunk_count * (i + 1);
+
+            if (split < at) {
+                split = at;
+            }
+
+            char *eol = sv_find_char((sv_t) { split, end }, '\n');
+            split = eol < end ? eol + 1 : end;
+        }
+
+        chunks[job.chunk_count++] = (obj_chunk_t) { .begin = at, .end = split };
+        at = split;
+    }
+
+    obj_run_pass(&job, obj_pass_parse);
+
+    u32 triangle_count = 0;
+
+    for (u32 i = 0; i < job.chunk_count; ++i) {
+        obj_chunk_t *chunk = chunks + i;
+
+        chunk->position_start = job.position_count;
+        chunk->normal_start   = job.normal_count;
+        chunk->texcoord_start = job.texcoord_count;
+        chunk->vertex_start   = mb->positions.count + triangle_count * 3;
+
+        job.position_count += (u32)chunk->positions.count;
+        job.normal_count   += (u32)chunk->normals.count;
+        job.texcoord_count += (u32)chunk->texcoords.count;
+
+        triangle_count += chunk->corners.count / 3;
+
+        dck_stretchy_for (chunk->mtllibs, sv_t, name) {
+            char *mtl_path = obj_sibling_path(path, *name);
+            obj_load_mtl(obj_o, mtl_path);
+            free(mtl_path);
+        }
+    }
+
+    job.positions = mem_alloc(mem_tag(), job.position_count * sizeof(Vector3) + 1);
+    job.normals   = mem_alloc(mem_tag(), job.normal_count   * sizeof(Vector3) + 1);
+    job.texcoords = mem_alloc(mem_tag(), job.texcoord_count * sizeof(Vector2) + 1);
+
+    if (!job.positions || !job.normals || !job.texcoords) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    obj_run_pass(&job, obj_pass_gather);
+
+    u32 vertex_count = triangle_count * 3;
+
+    dck_stretchy_reserve(mb->positions, vertex_count);
+    dck_stretchy_reserve(mb->normals,   vertex_count);
+    dck_stretchy_reserve(mb->texcoords, vertex_count);
+
+    obj_o->view = (mb_view_t) {
+        .vertex_start = mb->positions.count,
+        .vertex_count = vertex_count,
+    };
+
+    obj_run_pass(&job, obj_pass_emit);
+
+    mb->positions.count += vertex_count;
+    mb->normals.count   += vertex_count;
+    mb->texcoords.count += vertex_count;
+
+    // material switches, in file order
+    obj_group_t group = {
+        .material = OBJ_NO_MATERIAL,
+        .view     = { .vertex_start = obj_o->view.vertex_start },
+    };
+
+    u32 triangle_base = 0;
+
+    for (u32 i = 0; i < job.chunk_count; ++i) {
+        obj_chunk_t *chunk = chunks + i;
+
+        dck_stretchy_for (chunk->switches, obj_switch_t, sw) {
+            u32 vertex = obj_o->view.vertex_start + (triangle_base + sw->triangle) * 3;
+
+            group.view.vertex_count = vertex - group.view.vertex_start;
+            if (group.view.vertex_count) {
+                dck_stretchy_push(obj_o->groups, group);
+            }
+
+            group = (obj_group_t) {
+                .material = obj_find_material(obj_o, sw->name),
+                .view     = { .vertex_start = vertex },
+            };
+        }
+
+        triangle_base += chunk->corners.count / 3;
+        obj_o->errors += chunk->errors;
+
+        obj_chunk_free(chunk);
+    }
+
+    group.view.vertex_count = mb->positions.count - group.view.vertex_start;
+    if (group.view.vertex_count) {
+        dck_stretchy_push(obj_o->groups, group);
+    }
+
+    mem_free(job.positions);
+    mem_free(job.normals);
+    mem_free(job.texcoords);
+
+    io_unmap_file(&map);
+
+    if (obj_o->errors) {
+        fprintf(stderr, "%s: skipped %u malformed records\n", path, obj_o->errors);
+    }
+
+    return true;
+}
+
+#endif // OBJ_H_
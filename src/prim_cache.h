@@ -0,0 +1,124 @@
+#ifndef PRIM_CACHE_H_
+#define PRIM_CACHE_H_
+
+/* In-memory primitive cache.
+ *
+ * Primitive generators are pure functions of their parameters, and designs
+ * use a handful of stock sizes over and over. The cache keeps the geometry of
+ * every primitive generated so far in its local space, keyed by the generator
+ * and its exact parameters, and later calls copy it instead of running the
+ * generator again. The caller transforms the copy like a fresh one.
+ *
+ * Lookups and stores lock, generators may run on pool threads. The cache
+ * stops storing once it holds `PRIM_CACHE_MAX_VERTICES`, hits keep working.
+ */
+
+#include "core/utils.h"
+#include "core/dck.h"
+
+#include "mb.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define PRIM_CACHE_MAX_VERTICES (1u << 20)
+#define PRIM_CACHE_MAX_ARGS     5
+
+/* Compared bytewise, no padding, unused args stay zero. */
+typedef struct
+{
+    u32 generator;
+    f32 args[PRIM_CACHE_MAX_ARGS];
+} prim_cache_key_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+
+    mb_t mb;
+    dck_map_t (prim_cache_key_t, mb_view_t, u32) views; // in `mb`
+
+    u32 hits;
+    u32 misses;
+} prim_cache_t;
+
+#define PRIM_CACHE_INIT { .lock = PTHREAD_MUTEX_INITIALIZER }
+
+static inline prim_cache_key_t
+prim_cache_key(u32 generator, const f32 *args, u32 arg_count)
+{
+    ASSERT(arg_count <= PRIM_CACHE_MAX_ARGS);
+
+    prim_cache_key_t key = { .generator = generator };
+    memcpy(key.args, args, arg_count * sizeof(f32));
+
+    return key;
+}
+
+/* Copies the primitive of `key` into `mb` if it's cached. */
+b32
+prim_cache_copy(prim_cache_t *cache, prim_cache_key_t key, mb_t *mb, mb_view_t *view_o)
+{
+    b32 found = false;
+
+    pthread_mutex_lock(&cache->lock);
+
+    mb_view_t *view = dck_map_get(cache->views, key);
+
+    if (view) {
+        *view_o = mb_view_copy(mb, &cache->mb, *view);
+        found = true;
+    }
+
+    if (found) {
+        cache->hits += 1;
+    }
+    else {
+        cache->misses += 1;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return found;
+}
+
+/* Stores `view` of `mb` as the primitive of `key`, unless the cache is full
+ * or another thread got there first.
+ */
+void
+prim_cache_store(prim_cache_t *cache, prim_cache_key_t key, mb_t *mb, mb_view_t view)
+{
+    if (!view.vertex_count)
+        return;
+
+    pthread_mutex_lock(&cache->lock);
+
+    if (cache->mb.positions.count + view.vertex_count > PRIM_CACHE_MAX_VERTICES) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    if (!dck_map_get(cache->views, key)) {
+        mem_tag_t tag = mem_tag_set(mem_Cache);
+
+        mb_view_t copy = mb_view_copy(&cache->mb, mb, view);
+        dck_map_put(cache->views, key, copy);
+
+        mem_tag_set(tag);
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void
+prim_cache_free(prim_cache_t *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+
+    mb_free(&cache->mb);
+    dck_map_free(cache->views);
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+#endif // PRIM_CACHE_H_
@@ -0,0 +1,144 @@
+#ifndef REDRAW_H_
+#define REDRAW_H_
+
+/* Render-on-demand frame pacing.
+ *
+ * In idle mode the loop blocks on input events (raylib's event waiting) and
+ * only draws a frame when something requested it. A ticker thread posts an
+ * empty event every `REDRAW_TICK_MS` so polled state, like shader sources on
+ * disk, still gets looked at while nothing else happens.
+ *
+ * Continuous mode, and idle mode while something is animating, behave like a
+ * plain SetTargetFPS loop.
+ */
+
+#include "core/utils.h"
+
+#include <raylib.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define REDRAW_TICK_MS 250
+
+/* raylib is built on GLFW, which is the only thing that can wake up a thread
+ * blocked in glfwWaitEvents from another thread.
+ */
+void glfwPostEmptyEvent(void);
+
+typedef struct
+{
+    b32 continuous;
+    b32 dirty;
+
+    /* The previous iteration blocked waiting for events, so the frame time
+     * raylib reports includes the idle time.
+     */
+    b32 waited;
+
+    atomic_int ticker_stop;
+    pthread_t  ticker;
+    b32        ticker_running;
+} redraw_t;
+
+
+void *
+redraw_ticker(void *arg)
+{
+    redraw_t *redraw = arg;
+
+    struct timespec tick = {
+        .tv_sec  = REDRAW_TICK_MS / 1000,
+        .tv_nsec = (REDRAW_TICK_MS % 1000) * 1000000L,
+    };
+
+    while (!atomic_load(&redraw->ticker_stop)) {
+        nanosleep(&tick, NULL);
+        glfwPostEmptyEvent();
+    }
+
+    return NULL;
+}
+
+/* Has to be called after InitWindow. `redraw` must stay at the same address
+ * until `redraw_destroy`.
+ */
+void
+redraw_init(redraw_t *redraw, b32 continuous)
+{
+    *redraw = (redraw_t) {
+        .continuous = continuous,
+        .dirty      = true,
+    };
+
+    atomic_init(&redraw->ticker_stop, 0);
+
+    if (pthread_create(&redraw->ticker, NULL, redraw_ticker, redraw) == 0) {
+        redraw->ticker_running = true;
+    }
+    else {
+        fprintf(stderr, "Failed to start the redraw ticker, hot reload only checks on input.\n");
+    }
+}
+
+/* Has to be called before CloseWindow. */
+void
+redraw_destroy(redraw_t *redraw)
+{
+    if (redraw->ticker_running) {
+        atomic_store(&redraw->ticker_stop, 1);
+        pthread_join(redraw->ticker, NULL);
+        redraw->ticker_running = false;
+    }
+
+    DisableEventWaiting();
+}
+
+static inline void
+redraw_request(redraw_t *redraw)
+{
+    redraw->dirty = true;
+}
+
+/* Frame time to use for this iteration, zero right after waking up from idle. */
+static inline f32
+redraw_frame_time(redraw_t *redraw)
+{
+    return redraw->waited ? 0.0f : GetFrameTime();
+}
+
+/* Picks how the end of this iteration waits and returns whether a frame
+ * should be drawn. When it returns true draw with BeginDrawing/EndDrawing,
+ * otherwise call `redraw_skip`.
+ */
+b32
+redraw_begin(redraw_t *redraw, b32 animating)
+{
+    if (redraw->continuous || animating) {
+        DisableEventWaiting();
+        redraw->waited = false;
+        redraw->dirty  = false;
+        return true;
+    }
+
+    EnableEventWaiting();
+    redraw->waited = true;
+
+    if (redraw->dirty) {
+        redraw->dirty = false;
+        return true;
+    }
+
+    return false;
+}
+
+/* Blocks until the next input event or tick without presenting a frame. */
+static inline void
+redraw_skip(redraw_t *redraw)
+{
+    (void)redraw;
+    PollInputEvents();
+}
+
+#endif // REDRAW_H_
@@ -0,0 +1,583 @@
+#ifndef SHADER_CACHE_H_
+#define SHADER_CACHE_H_
+
+/* Shader program binary cache and hot reload.
+ *
+ * Linked programs are stored with glGetProgramBinary, one entry per vertex and
+ * fragment pair, keyed by a hash of both sources and the driver
+ * identification strings, and restored with glProgramBinary on later runs. Anything unexpected (missing extension,
+ * driver rejecting the binary) falls back to compiling from source.
+ *
+ * raylib doesn't expose the program binary entry points, they're fetched from
+ * the GLFW it's built with. When caching, programs are linked here instead of
+ * by raylib, so the retrievable binary hint can be set before linking.
+ */
+
+#include "core/utils.h"
+#include "core/io.h"
+
+#include "cache.h"
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include <string.h>
+
+#define SHADER_CACHE_MAGIC      0x47525042 /* "BPRG" */
+#define SHADER_CACHE_VERSION    2
+#define SHADER_CACHE_EXT        ".bprog"
+
+/* Seconds between source stamp checks while watching. */
+#define SHADER_WATCH_INTERVAL   0.25
+
+#define SHADER_CACHE_GL_VENDOR                          0x1F00
+#define SHADER_CACHE_GL_RENDERER                        0x1F01
+#define SHADER_CACHE_GL_VERSION                         0x1F02
+#define SHADER_CACHE_GL_TRUE                            1
+#define SHADER_CACHE_GL_LINK_STATUS                     0x8B82
+#define SHADER_CACHE_GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define SHADER_CACHE_GL_PROGRAM_BINARY_LENGTH           0x8741
+#define SHADER_CACHE_GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+
+#if defined(_WIN32)
+    #define SHADER_CACHE_APIENTRY __stdcall
+#else
+    #define SHADER_CACHE_APIENTRY
+#endif
+
+typedef void (*shader_cache_glproc_t)(void);
+
+shader_cache_glproc_t glfwGetProcAddress(const char *procname);
+
+typedef u32 (SHADER_CACHE_APIENTRY *shader_cache_gl_create_program_t)(void);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_delete_program_t)(u32 program);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_get_programiv_t)(u32 program, u32 pname, i32 *params);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_program_parameteri_t)(u32 program, u32 pname, i32 value);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_attach_shader_t)(u32 program, u32 shader);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_detach_shader_t)(u32 program, u32 shader);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_delete_shader_t)(u32 shader);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_bind_attrib_location_t)(u32 program, u32 index, const char *name);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_link_program_t)(u32 program);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_get_integerv_t)(u32 pname, i32 *data);
+typedef const u8 *(SHADER_CACHE_APIENTRY *shader_cache_gl_get_string_t)(u32 name);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_get_program_binary_t)(u32 program, i32 buf_size, i32 *length,
+                                                                           u32 *binary_format, void *binary);
+typedef void (SHADER_CACHE_APIENTRY *shader_cache_gl_program_binary_t)(u32 program, u32 binary_format,
+                                                                       const void *binary, i32 length);
+
+typedef struct
+{
+    shader_cache_gl_create_program_t       CreateProgram;
+    shader_cache_gl_delete_program_t       DeleteProgram;
+    shader_cache_gl_get_programiv_t        GetProgramiv;
+    shader_cache_gl_program_parameteri_t   ProgramParameteri;
+    shader_cache_gl_attach_shader_t        AttachShader;
+    shader_cache_gl_detach_shader_t        DetachShader;
+    shader_cache_gl_delete_shader_t        DeleteShader;
+    shader_cache_gl_bind_attrib_location_t BindAttribLocation;
+    shader_cache_gl_link_program_t         LinkProgram;
+    shader_cache_gl_get_integerv_t         GetIntegerv;
+    shader_cache_gl_get_string_t           GetString;
+    shader_cache_gl_get_program_binary_t   GetProgramBinary;
+    shader_cache_gl_program_binary_t       ProgramBinary;
+} shader_cache_gl_t;
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+
+    u64 key;
+
+    // sources the binary was linked from, informational, `key` decides
+    cache_stamp_t vertex_stamp;
+    cache_stamp_t fragment_stamp;
+
+    u32 binary_format;
+    u32 binary_size;
+} shader_cache_header_t;
+
+/* Sources read by `shader_cache_prepare`, waiting for the GL thread. */
+typedef struct
+{
+    char *vertex_code;
+    char *fragment_code;
+    u64   source_hash;
+
+    cache_stamp_t vertex_stamp;
+    cache_stamp_t fragment_stamp;
+
+    char     *entry_path;
+    io_map_t  entry; // begin is NULL when there's no cache entry
+} shader_cache_pending_t;
+
+typedef struct
+{
+    Shader shader;
+
+    const char *vertex_path;
+    const char *fragment_path;
+
+    cache_stamp_t vertex_stamp;
+    cache_stamp_t fragment_stamp;
+
+    f64 last_check;
+} shader_watch_t;
+
+
+static shader_cache_gl_t shader_cache_gl;
+static i32 shader_cache_gl_state; // 0 = not loaded yet, 1 = usable, -1 = unsupported
+
+b32
+shader_cache_gl_load(void)
+{
+    if (shader_cache_gl_state)
+        return shader_cache_gl_state > 0;
+
+    shader_cache_gl_t *gl = &shader_cache_gl;
+
+    gl->CreateProgram      = (shader_cache_gl_create_program_t)glfwGetProcAddress("glCreateProgram");
+    gl->DeleteProgram      = (shader_cache_gl_delete_program_t)glfwGetProcAddress("glDeleteProgram");
+    gl->GetProgramiv       = (shader_cache_gl_get_programiv_t)glfwGetProcAddress("glGetProgramiv");
+    gl->ProgramParameteri  = (shader_cache_gl_program_parameteri_t)glfwGetProcAddress("glProgramParameteri");
+    gl->AttachShader       = (shader_cache_gl_attach_shader_t)glfwGetProcAddress("glAttachShader");
+    gl->DetachShader       = (shader_cache_gl_detach_shader_t)glfwGetProcAddress("glDetachShader");
+    gl->DeleteShader       = (shader_cache_gl_delete_shader_t)glfwGetProcAddress("glDeleteShader");
+    gl->BindAttribLocation = (shader_cache_gl_bind_attrib_location_t)glfwGetProcAddress("glBindAttribLocation");
+    gl->LinkProgram        = (shader_cache_gl_link_program_t)glfwGetProcAddress("glLinkProgram");
+    gl->GetIntegerv        = (shader_cache_gl_get_integerv_t)glfwGetProcAddress("glGetIntegerv");
+    gl->GetString          = (shader_cache_gl_get_string_t)glfwGetProcAddress("glGetString");
+    gl->GetProgramBinary   = (shader_cache_gl_get_program_binary_t)glfwGetProcAddress("glGetProgramBinary");
+    gl->ProgramBinary      = (shader_cache_gl_program_binary_t)glfwGetProcAddress("glProgramBinary");
+
+    shader_cache_gl_state = -1;
+
+    if (!gl->CreateProgram || !gl->DeleteProgram || !gl->GetProgramiv || !gl->GetIntegerv
+     || !gl->GetString || !gl->GetProgramBinary || !gl->ProgramBinary || !gl->ProgramParameteri
+     || !gl->AttachShader || !gl->DetachShader || !gl->DeleteShader || !gl->BindAttribLocation
+     || !gl->LinkProgram)
+        return false;
+
+    i32 format_count = 0;
+    gl->GetIntegerv(SHADER_CACHE_GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+    if (format_count <= 0)
+        return false;
+
+    shader_cache_gl_state = 1;
+    return true;
+}
+
+/* Returns the allocated entry path of a program, named after both sources,
+ * e.g. "cache/res_a.vert.glsl+res_a.frag.glsl.bprog".
+ */
+char *
+shader_cache_entry_path(const char *vertex_path, const char *fragment_path)
+{
+    size_t vertex_len   = strlen(vertex_path);
+    size_t fragment_len = strlen(fragment_path);
+
+    char *name = malloc(vertex_len + 1 + fragment_len + 1);
+    if (!name) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    memcpy(name, vertex_path, vertex_len);
+    name[vertex_len] = '+';
+    memcpy(name + vertex_len + 1, fragment_path, fragment_len + 1);
+
+    char *path = cache_path(name, SHADER_CACHE_EXT);
+
+    free(name);
+
+    return path;
+}
+
+/* Returns allocated, NUL terminated contents of `path`, or NULL. Release with
+ * mem_free.
+ */
+char *
+shader_cache_read_source(const char *path)
+{
+    size_t size;
+    u8 *data = io_read_file(path, &size);
+    if (!data)
+        return NULL;
+
+    char *text = mem_realloc(mem_Io, data, size + 1);
+    if (!text) {
+        mem_free(data);
+        return NULL;
+    }
+
+    text[size] = '\0';
+    return text;
+}
+
+/* Hash of both sources, the part of the key that doesn't need GL. */
+u64
+shader_cache_source_hash(const char *vertex_code, const char *fragment_code)
+{
+    u64 hash = CACHE_HASH_SEED;
+
+    hash = cache_hash(vertex_code,   strlen(vertex_code)   + 1, hash);
+    hash = cache_hash(fragment_code, strlen(fragment_code) + 1, hash);
+
+    return hash;
+}
+
+/* Mixes the driver identification into `source_hash`. GL thread only. */
+u64
+shader_cache_key(u64 source_hash)
+{
+    u64 key = source_hash;
+
+    u32 names[] = { SHADER_CACHE_GL_VENDOR, SHADER_CACHE_GL_RENDERER, SHADER_CACHE_GL_VERSION };
+
+    for (u32 i = 0; i < LENGTH_OF(names); ++i) {
+        const char *str = (const char *)shader_cache_gl.GetString(names[i]);
+        if (str) {
+            key = cache_hash(str, strlen(str) + 1, key);
+        }
+    }
+
+    return key;
+}
+
+/* Same default locations LoadShaderFromMemory sets up. */
+void
+shader_cache_default_locations(Shader *shader)
+{
+    shader->locs = malloc(RL_MAX_SHADER_LOCATIONS * sizeof(i32));
+    if (!shader->locs) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    for (i32 i = 0; i < RL_MAX_SHADER_LOCATIONS; ++i) {
+        shader->locs[i] = -1;
+    }
+
+    u32 id = shader->id;
+
+    shader->locs[SHADER_LOC_VERTEX_POSITION]   = rlGetLocationAttrib(id, "vertexPosition");
+    shader->locs[SHADER_LOC_VERTEX_TEXCOORD01] = rlGetLocationAttrib(id, "vertexTexCoord");
+    shader->locs[SHADER_LOC_VERTEX_TEXCOORD02] = rlGetLocationAttrib(id, "vertexTexCoord2");
+    shader->locs[SHADER_LOC_VERTEX_NORMAL]     = rlGetLocationAttrib(id, "vertexNormal");
+    shader->locs[SHADER_LOC_VERTEX_TANGENT]    = rlGetLocationAttrib(id, "vertexTangent");
+    shader->locs[SHADER_LOC_VERTEX_COLOR]      = rlGetLocationAttrib(id, "vertexColor");
+
+    shader->locs[SHADER_LOC_MATRIX_MVP]        = rlGetLocationUniform(id, "mvp");
+    shader->locs[SHADER_LOC_MATRIX_VIEW]       = rlGetLocationUniform(id, "matView");
+    shader->locs[SHADER_LOC_MATRIX_PROJECTION] = rlGetLocationUniform(id, "matProjection");
+    shader->locs[SHADER_LOC_MATRIX_MODEL]      = rlGetLocationUniform(id, "matModel");
+    shader->locs[SHADER_LOC_MATRIX_NORMAL]     = rlGetLocationUniform(id, "matNormal");
+
+    shader->locs[SHADER_LOC_COLOR_DIFFUSE]     = rlGetLocationUniform(id, "colDiffuse");
+    shader->locs[SHADER_LOC_MAP_DIFFUSE]       = rlGetLocationUniform(id, "texture0");
+    shader->locs[SHADER_LOC_MAP_SPECULAR]      = rlGetLocationUniform(id, "texture1");
+    shader->locs[SHADER_LOC_MAP_NORMAL]        = rlGetLocationUniform(id, "texture2");
+}
+
+/* Links the program from the mapped cache entry of `pending` if it was stored
+ * for `key`. Sources touched without a change only get their stamps updated.
+ */
+b32
+shader_cache_load_binary(const shader_cache_pending_t *pending, u64 key, Shader *shader_o)
+{
+    io_map_t entry = pending->entry;
+
+    shader_cache_header_t header = {0};
+    size_t entry_size = io_map_size(entry);
+
+    if (entry_size >= sizeof(header)) {
+        memcpy(&header, entry.begin, sizeof(header));
+    }
+
+    if (entry_size < sizeof(header)
+     || header.magic       != SHADER_CACHE_MAGIC
+     || header.version     != SHADER_CACHE_VERSION
+     || header.key         != key
+     || header.binary_size != entry_size - sizeof(header))
+        return false;
+
+    shader_cache_gl_t *gl = &shader_cache_gl;
+
+    u32 id = gl->CreateProgram();
+    gl->ProgramBinary(id, header.binary_format, entry.begin + sizeof(header), header.binary_size);
+
+    i32 status = 0;
+    gl->GetProgramiv(id, SHADER_CACHE_GL_LINK_STATUS, &status);
+
+    if (!status) {
+        gl->DeleteProgram(id);
+        return false;
+    }
+
+    if (!cache_stamp_eq(header.vertex_stamp,   pending->vertex_stamp)
+     || !cache_stamp_eq(header.fragment_stamp, pending->fragment_stamp)) {
+        header.vertex_stamp   = pending->vertex_stamp;
+        header.fragment_stamp = pending->fragment_stamp;
+        cache_rewrite_header(pending->entry_path, &header, sizeof(header));
+    }
+
+    *shader_o = (Shader) { .id = id };
+    shader_cache_default_locations(shader_o);
+
+    return true;
+}
+
+/* Compiles and links like LoadShaderFromMemory, with the same attribute
+ * locations, but asks for a retrievable binary before linking. Drivers that
+ * honour the hint return no binary without it.
+ */
+b32
+shader_cache_link(const char *vertex_code, const char *fragment_code, Shader *shader_o)
+{
+    static const struct { u32 location; const char *name; } attribs[] = {
+        { 0, "vertexPosition"  },
+        { 1, "vertexTexCoord"  },
+        { 2, "vertexNormal"    },
+        { 3, "vertexColor"     },
+        { 4, "vertexTangent"   },
+        { 5, "vertexTexCoord2" },
+    };
+
+    shader_cache_gl_t *gl = &shader_cache_gl;
+
+    u32 vertex   = rlCompileShader(vertex_code,   RL_VERTEX_SHADER);
+    u32 fragment = rlCompileShader(fragment_code, RL_FRAGMENT_SHADER);
+
+    i32 status = 0;
+    u32 id = 0;
+
+    if (vertex && fragment) {
+        id = gl->CreateProgram();
+
+        gl->AttachShader(id, vertex);
+        gl->AttachShader(id, fragment);
+
+        for (u32 i = 0; i < LENGTH_OF(attribs); ++i) {
+            gl->BindAttribLocation(id, attribs[i].location, attribs[i].name);
+        }
+
+        gl->ProgramParameteri(id, SHADER_CACHE_GL_PROGRAM_BINARY_RETRIEVABLE_HINT, SHADER_CACHE_GL_TRUE);
+        gl->LinkProgram(id);
+        gl->GetProgramiv(id, SHADER_CACHE_GL_LINK_STATUS, &status);
+
+        gl->DetachShader(id, vertex);
+        gl->DetachShader(id, fragment);
+    }
+
+    if (vertex)   gl->DeleteShader(vertex);
+    if (fragment) gl->DeleteShader(fragment);
+
+    if (!status) {
+        if (id) {
+            fprintf(stderr, "Failed to link shader program\n");
+            gl->DeleteProgram(id);
+        }
+
+        return false;
+    }
+
+    *shader_o = (Shader) { .id = id };
+    shader_cache_default_locations(shader_o);
+
+    return true;
+}
+
+void
+shader_cache_store_binary(const shader_cache_pending_t *pending, u64 key, Shader shader)
+{
+    shader_cache_gl_t *gl = &shader_cache_gl;
+
+    i32 length = 0;
+    gl->GetProgramiv(shader.id, SHADER_CACHE_GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0)
+        return;
+
+    void *binary = mem_alloc(mem_Cache, length);
+    if (!binary)
+        return;
+
+    shader_cache_header_t header = {
+        .magic   = SHADER_CACHE_MAGIC,
+        .version = SHADER_CACHE_VERSION,
+        .key     = key,
+
+        .vertex_stamp   = pending->vertex_stamp,
+        .fragment_stamp = pending->fragment_stamp,
+    };
+
+    i32 written = 0;
+    gl->GetProgramBinary(shader.id, length, &written, &header.binary_format, binary);
+
+    if (written > 0) {
+        header.binary_size = written;
+        cache_write(pending->entry_path, &header, sizeof(header), binary, written);
+    }
+
+    mem_free(binary);
+}
+
+/* Reads both sources and maps the cache entry, without touching GL, so it
+ * can run on any thread. Returns false if the sources can't be read.
+ */
+b32
+shader_cache_prepare(const char *vertex_path, const char *fragment_path, shader_cache_pending_t *pending_o)
+{
+    *pending_o = (shader_cache_pending_t) {0};
+
+    char *vertex_code   = shader_cache_read_source(vertex_path);
+    char *fragment_code = shader_cache_read_source(fragment_path);
+
+    if (!vertex_code || !fragment_code) {
+        mem_free(vertex_code);
+        mem_free(fragment_code);
+        return false;
+    }
+
+    char *entry_path = shader_cache_entry_path(vertex_path, fragment_path);
+
+    *pending_o = (shader_cache_pending_t) {
+        .vertex_code   = vertex_code,
+        .fragment_code = fragment_code,
+        .source_hash   = shader_cache_source_hash(vertex_code, fragment_code),
+        .entry_path    = entry_path,
+    };
+
+    cache_stamp_get(vertex_path,   &pending_o->vertex_stamp);
+    cache_stamp_get(fragment_path, &pending_o->fragment_stamp);
+
+    if (!io_map_file(entry_path, io_map_WillNeed, &pending_o->entry)) {
+        pending_o->entry = (io_map_t) {0};
+    }
+
+    return true;
+}
+
+/* Restores the cached binary when the sources and driver match, compiles
+ * from source otherwise, and releases `pending`. GL thread only.
+ * Returns false if the sources don't compile.
+ */
+b32
+shader_cache_finish(shader_cache_pending_t *pending, Shader *shader_o)
+{
+    b32 res = false;
+    b32 cacheable = shader_cache_gl_load();
+    u64 key = 0;
+
+    if (cacheable) {
+        key = shader_cache_key(pending->source_hash);
+
+        if (pending->entry.begin && shader_cache_load_binary(pending, key, shader_o)) {
+            res = true;
+            goto done;
+        }
+    }
+
+    Shader shader = {0};
+
+    if (!cacheable) {
+        shader = LoadShaderFromMemory(pending->vertex_code, pending->fragment_code);
+    }
+    else if (shader_cache_link(pending->vertex_code, pending->fragment_code, &shader)) {
+        shader_cache_store_binary(pending, key, shader);
+    }
+
+    if (IsShaderReady(shader)) {
+        *shader_o = shader;
+        res = true;
+    }
+
+done:
+    if (pending->entry.begin) {
+        io_unmap_file(&pending->entry);
+    }
+
+    free(pending->entry_path);
+    mem_free(pending->vertex_code);
+    mem_free(pending->fragment_code);
+
+    *pending = (shader_cache_pending_t) {0};
+
+    return res;
+}
+
+/* Compiles from source, or restores the cached binary when the sources and
+ * driver match. Returns false if the sources can't be read or don't compile.
+ */
+b32
+shader_cache_load(const char *vertex_path, const char *fragment_path, Shader *shader_o)
+{
+    shader_cache_pending_t pending;
+
+    if (!shader_cache_prepare(vertex_path, fragment_path, &pending))
+        return false;
+
+    return shader_cache_finish(&pending, shader_o);
+}
+
+shader_watch_t
+shader_watch_create(const char *vertex_path, const char *fragment_path, Shader shader)
+{
+    shader_watch_t watch = {
+        .shader        = shader,
+        .vertex_path   = vertex_path,
+        .fragment_path = fragment_path,
+        .last_check    = GetTime(),
+    };
+
+    cache_stamp_get(vertex_path,   &watch.vertex_stamp);
+    cache_stamp_get(fragment_path, &watch.fragment_stamp);
+
+    return watch;
+}
+
+/* Recompiles the program when either source changed on disk. On failure the
+ * previous program stays in use. Returns true when `watch->shader` was
+ * replaced, uniform locations have to be looked up again in that case.
+ */
+b32
+shader_watch_poll(shader_watch_t *watch)
+{
+    f64 now = GetTime();
+
+    if (now - watch->last_check < SHADER_WATCH_INTERVAL)
+        return false;
+
+    watch->last_check = now;
+
+    cache_stamp_t vertex_stamp, fragment_stamp;
+
+    if (!cache_stamp_get(watch->vertex_path,   &vertex_stamp)
+     || !cache_stamp_get(watch->fragment_path, &fragment_stamp))
+        return false;
+
+    if (cache_stamp_eq(vertex_stamp,   watch->vertex_stamp)
+     && cache_stamp_eq(fragment_stamp, watch->fragment_stamp))
+        return false;
+
+    watch->vertex_stamp   = vertex_stamp;
+    watch->fragment_stamp = fragment_stamp;
+
+    Shader shader;
+
+    if (!shader_cache_load(watch->vertex_path, watch->fragment_path, &shader)) {
+        fprintf(stderr, "Failed to reload shader: (%s, %s), keeping the previous one\n",
+                watch->vertex_path, watch->fragment_path);
+        return false;
+    }
+
+    UnloadShader(watch->shader);
+    watch->shader = shader;
+
+    printf("Reloaded shader: (%s, %s)\n", watch->vertex_path, watch->fragment_path);
+
+    return true;
+}
+
+#endif // SHADER_CACHE_H_
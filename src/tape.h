@@ -0,0 +1,814 @@
+#ifndef TAPE_H_
+#define TAPE_H_
+
+/* Generator tapes.
+ *
+ * A generator records what it would do to an mb as a flat list of ops
+ * instead of doing it: emit a primitive, transform a view, dupe a view, and
+ * begin/end a group that covers everything emitted in between. Ops refer to
+ * views through slots, handles returned while recording, the same way the
+ * direct mb calls pass mb_view_t around.
+ *
+ * Running a tape produces the same vertices, in the same order, as the
+ * direct calls. On the way it
+ *
+ *   - replays ops in a plain loop, no recursion,
+ *   - memoizes units, a group or a single emit, that show up more than once
+ *     with identical contents: the first one is snapshotted when it's done,
+ *     the others are copied from the snapshot instead of being replayed,
+ *   - with a job pool, runs self-contained groups (no slot references leaving
+ *     them) on the pool into private mbs and splices the results in order.
+ */
+
+#include "core/utils.h"
+#include "core/dck.h"
+#include "core/jobs.h"
+
+#include "cache.h"
+#include "mb.h"
+
+#include <raylib.h>
+
+#include <pthread.h>
+#include <string.h>
+
+#define TAPE_MAX_ARGS   5
+#define TAPE_MAX_DEPTH  64
+#define TAPE_NO_UNIT    ((u32)-1)
+
+typedef enum
+{
+    tape_Emit,
+    tape_Transform,
+    tape_Dupe,
+    tape_Begin,
+    tape_End,
+} tape_op_kind_t;
+
+typedef enum
+{
+    tape_None = 0,
+    tape_Part = (1 << 0), // emit: record the primitive as a part
+} tape_flags_t;
+
+typedef struct
+{
+    u32 kind;
+    u32 flags;
+
+    u32 slot;      // written by emit, dupe and begin, read by transform and end
+    u32 source;    // dupe: slot copied, end: index of the begin op
+
+    u32 primitive; // emit: interpreted by the emit callback
+    f32 args[TAPE_MAX_ARGS];
+
+    affine_t matrix;
+} tape_op_t;
+
+/* Filled in by `tape_compile` for every emit and begin op. */
+typedef struct
+{
+    u64 hash;
+    u32 end;       // index of the last op of the unit
+    u32 slot_end;  // one past the last slot written inside the unit
+    u32 first;     // first unit with the same contents, TAPE_NO_UNIT when unique
+    u32 depth;
+    b32 contained; // no slot references leave the unit
+} tape_unit_t;
+
+typedef struct
+{
+    dck_stretchy_t (tape_op_t, u32) ops;
+    u32 slot_count;
+
+    u32 open[TAPE_MAX_DEPTH];
+    u32 depth;
+
+    // compiled
+    tape_unit_t *units;
+    dck_stretchy_t (u32, u32) branches; // begin ops run on the pool
+
+    // last run
+    mb_view_t *views; // indexed by slot
+    u32 memo_hits;
+} tape_t;
+
+/* Emits `primitive` with `args` in its local space. Called from pool threads
+ * when running with one.
+ */
+typedef mb_view_t (*tape_emit_t)(mb_t *mb, u32 primitive, const f32 *args);
+
+
+static inline u32
+tape_push(tape_t *tape, tape_op_t op)
+{
+    dck_stretchy_push(tape->ops, op);
+
+    mem_free(tape->units);
+    tape->units = NULL;
+
+    return tape->ops.count - 1;
+}
+
+u32
+tape_emit(tape_t *tape, u32 primitive, const f32 *args, u32 arg_count, u32 flags)
+{
+    tape_op_t op = {
+        .kind      = tape_Emit,
+        .flags     = flags,
+        .slot      = tape->slot_count++,
+        .primitive = primitive,
+    };
+
+    ASSERT(arg_count <= TAPE_MAX_ARGS);
+    memcpy(op.args, args, arg_count * sizeof(f32));
+
+    tape_push(tape, op);
+
+    return op.slot;
+}
+
+void
+tape_transform(tape_t *tape, u32 slot, affine_t matrix)
+{
+    tape_push(tape, (tape_op_t) {
+        .kind   = tape_Transform,
+        .slot   = slot,
+        .matrix = matrix,
+    });
+}
+
+u32
+tape_dupe(tape_t *tape, u32 slot, affine_t matrix)
+{
+    tape_op_t op = {
+        .kind   = tape_Dupe,
+        .slot   = tape->slot_count++,
+        .source = slot,
+        .matrix = matrix,
+    };
+
+    tape_push(tape, op);
+
+    return op.slot;
+}
+
+u32
+tape_begin(tape_t *tape)
+{
+    if (tape->depth == TAPE_MAX_DEPTH) {
+        fprintf(stderr, "%s:%d: tape groups nested too deep! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    tape_op_t op = {
+        .kind = tape_Begin,
+        .slot = tape->slot_count++,
+    };
+
+    tape->open[tape->depth++] = tape_push(tape, op);
+
+    return op.slot;
+}
+
+void
+tape_end(tape_t *tape, u32 slot)
+{
+    ASSERT(tape->depth > 0);
+
+    u32 begin = tape->open[--tape->depth];
+
+    ASSERT(tape->ops.data[begin].slot == slot);
+
+    tape_push(tape, (tape_op_t) {
+        .kind   = tape_End,
+        .slot   = slot,
+        .source = begin,
+    });
+}
+
+void
+tape_free(tape_t *tape)
+{
+    dck_stretchy_free(tape->ops);
+    mem_free(tape->units);
+    dck_stretchy_free(tape->branches);
+    mem_free(tape->views);
+
+    *tape = (tape_t) {0};
+}
+
+typedef struct
+{
+    u64 hash;
+    u32 unit;
+} tape_key_t;
+
+int
+tape_key_cmp(const void *a, const void *b)
+{
+    const tape_key_t *ka = a;
+    const tape_key_t *kb = b;
+
+    if (ka->hash != kb->hash)
+        return (ka->hash > kb->hash) - (ka->hash < kb->hash);
+
+    return (ka->unit > kb->unit) - (ka->unit < kb->unit);
+}
+
+/* Hashes the op with its slots relative to `base`, clears `*contained_io`
+ * when it refers to a slot from before the unit.
+ */
+static inline u64
+tape_hash_op(const tape_op_t *op, u32 base_op, u32 base, b32 *contained_io, u64 hash)
+{
+    u32 fields[4] = { op->kind, op->flags, op->primitive, 0 };
+
+    if (op->kind == tape_Transform || op->kind == tape_Dupe) {
+        u32 ref = op->kind == tape_Dupe ? op->source : op->slot;
+
+        if (ref < base) {
+            *contained_io = false;
+        }
+
+        fields[3] = ref - base;
+    }
+    else if (op->kind == tape_End) {
+        fields[3] = op->source - base_op;
+    }
+
+    hash = cache_hash(fields, sizeof(fields), hash);
+
+    if (op->kind == tape_Emit) {
+        hash = cache_hash(op->args, sizeof(op->args), hash);
+    }
+    else if (op->kind == tape_Transform || op->kind == tape_Dupe) {
+        hash = cache_hash(&op->matrix, sizeof(op->matrix), hash);
+    }
+
+    return hash;
+}
+
+/* Whether two ops are the same after making their slots relative, the
+ * comparison behind `tape_hash_op`.
+ */
+static inline b32
+tape_op_eq(const tape_op_t *a, u32 a_base_op, u32 a_base,
+           const tape_op_t *b, u32 b_base_op, u32 b_base)
+{
+    if (a->kind != b->kind || a->flags != b->flags || a->primitive != b->primitive)
+        return false;
+
+    if (a->kind == tape_Emit)
+        return memcmp(a->args, b->args, sizeof(a->args)) == 0;
+
+    if (a->kind == tape_Transform || a->kind == tape_Dupe) {
+        u32 a_ref = a->kind == tape_Dupe ? a->source : a->slot;
+        u32 b_ref = b->kind == tape_Dupe ? b->source : b->slot;
+
+        return a_ref - a_base == b_ref - b_base
+            && memcmp(&a->matrix, &b->matrix, sizeof(a->matrix)) == 0;
+    }
+
+    if (a->kind == tape_End)
+        return a->source - a_base_op == b->source - b_base_op;
+
+    return true;
+}
+
+/* Compares the ops of the units starting at `a` and `b`, so units with equal
+ * hashes are only shared when they really are the same.
+ */
+b32
+tape_unit_eq(const tape_t *tape, u32 a, u32 b)
+{
+    const tape_unit_t *unit_a = tape->units + a;
+    const tape_unit_t *unit_b = tape->units + b;
+
+    if (unit_a->end - a != unit_b->end - b)
+        return false;
+
+    u32 a_base = tape->ops.data[a].slot;
+    u32 b_base = tape->ops.data[b].slot;
+
+    for (u32 k = 0; k <= unit_a->end - a; ++k) {
+        if (!tape_op_eq(tape->ops.data + a + k, a, a_base, tape->ops.data + b + k, b, b_base))
+            return false;
+    }
+
+    return true;
+}
+
+/* Finds the units, their repeats and the branches. Called by `tape_run` when
+ * the tape changed since the last compile.
+ */
+void
+tape_compile(tape_t *tape)
+{
+    ASSERT(tape->depth == 0);
+
+    u32 op_count = tape->ops.count;
+
+    mem_free(tape->units);
+    tape->units = mem_calloc(mem_tag(), op_count ? op_count : 1, sizeof(*tape->units));
+    if (!tape->units) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    tape->branches.count = 0;
+
+    u32 key_count = 0;
+    tape_key_t *keys = mem_alloc(mem_tag(), (op_count ? op_count : 1) * sizeof(*keys));
+    if (!keys) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    // groups are hashed once they end, the stack holds the open ones
+    u32 stack[TAPE_MAX_DEPTH];
+    u32 depth = 0;
+
+    // slot numbers only grow, so the slots written inside a unit are the ones
+    // from its own slot up to the slot counter at its end
+    u32 *slot_after = mem_alloc(mem_tag(), (op_count ? op_count : 1) * sizeof(*slot_after));
+    if (!slot_after) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    u32 slots = 0;
+
+    for (u32 i = 0; i < op_count; ++i) {
+        tape_op_t *op = tape->ops.data + i;
+
+        if (op->kind == tape_Emit || op->kind == tape_Dupe || op->kind == tape_Begin) {
+            slots = op->slot + 1;
+        }
+
+        slot_after[i] = slots;
+    }
+
+    for (u32 i = 0; i < op_count; ++i) {
+        tape_op_t *op = tape->ops.data + i;
+        tape_unit_t *unit = tape->units + i;
+
+        if (op->kind == tape_Emit) {
+            b32 contained = true;
+
+            *unit = (tape_unit_t) {
+                .hash      = tape_hash_op(op, i, op->slot, &contained, CACHE_HASH_SEED),
+                .end       = i,
+                .slot_end  = op->slot + 1,
+                .first     = TAPE_NO_UNIT,
+                .depth     = depth,
+                .contained = true,
+            };
+
+            keys[key_count++] = (tape_key_t) { unit->hash, i };
+        }
+        else if (op->kind == tape_Begin) {
+            stack[depth++] = i;
+        }
+        else if (op->kind == tape_End) {
+            u32 begin = stack[--depth];
+            u32 base  = tape->ops.data[begin].slot;
+
+            b32 contained = true;
+            u64 hash = CACHE_HASH_SEED;
+
+            for (u32 k = begin; k <= i; ++k) {
+                hash = tape_hash_op(tape->ops.data + k, begin, base, &contained, hash);
+            }
+
+            tape->units[begin] = (tape_unit_t) {
+                .hash      = hash,
+                .end       = i,
+                .slot_end  = slot_after[i],
+                .first     = TAPE_NO_UNIT,
+                .depth     = depth,
+                .contained = contained,
+            };
+
+            if (contained) {
+                keys[key_count++] = (tape_key_t) { hash, begin };
+            }
+        }
+    }
+
+    // repeats point at the first unit with the same contents, units sharing
+    // a hash are compared op by op in case it collided
+    qsort(keys, key_count, sizeof(*keys), tape_key_cmp);
+
+    for (u32 i = 0; i < key_count; ) {
+        u32 j = i + 1;
+
+        while (j < key_count && keys[j].hash == keys[i].hash) {
+            ++j;
+        }
+
+        for (u32 k = i + 1; k < j; ++k) {
+            u32 unit = keys[k].unit;
+
+            for (u32 m = i; m < k; ++m) {
+                u32 other = keys[m].unit;
+                u32 first = tape->units[other].first;
+
+                // only compare against the first of each set of repeats
+                if (first != TAPE_NO_UNIT && first != other)
+                    continue;
+
+                if (tape_unit_eq(tape, other, unit)) {
+                    tape->units[other].first = other;
+                    tape->units[unit].first  = other;
+                    break;
+                }
+            }
+        }
+
+        i = j;
+    }
+
+    mem_free(keys);
+    mem_free(slot_after);
+
+    // branches are the contained groups at the shallowest depth that has more
+    // than one of them, a lone group around everything isn't worth a job
+    u32 counts[TAPE_MAX_DEPTH] = {0};
+
+    for (u32 i = 0; i < op_count; ++i) {
+        tape_unit_t *unit = tape->units + i;
+
+        if (tape->ops.data[i].kind == tape_Begin && unit->contained) {
+            counts[unit->depth] += 1;
+        }
+    }
+
+    u32 branch_depth = TAPE_MAX_DEPTH;
+
+    for (u32 d = 0; d < TAPE_MAX_DEPTH; ++d) {
+        if (counts[d] > 1) {
+            branch_depth = d;
+            break;
+        }
+    }
+
+    for (u32 i = 0; i < op_count; ++i) {
+        tape_unit_t *unit = tape->units + i;
+
+        if (tape->ops.data[i].kind != tape_Begin || !unit->contained || unit->depth != branch_depth)
+            continue;
+
+        dck_stretchy_push(tape->branches, i);
+
+        // nested branch candidates can't exist at a deeper depth, skip the body
+        i = unit->end;
+    }
+}
+
+/* Snapshot of a unit's geometry when it ended, with its slots and parts
+ * relative to its first vertex.
+ */
+typedef struct
+{
+    b32 ready;
+
+    u32 vertex_start, vertex_count;
+    u32 slot_start;
+    u32 part_start, part_count;
+} tape_memo_entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+
+    mb_t mb;
+    mb_views_t slots;
+    mb_views_t parts;
+
+    tape_memo_entry_t *entries; // indexed by the unit's first op
+
+    u32 hits;
+} tape_memo_t;
+
+typedef struct
+{
+    u32 op;
+    u32 part_start;
+} tape_recording_t;
+
+typedef struct
+{
+    tape_t *tape;
+    tape_emit_t emit;
+    tape_memo_t *memo;
+
+    mb_t *mb;
+    mb_views_t *parts;
+    mb_view_t *views; // indexed by slot, shared between branches
+
+    // groups being recorded for the memo
+    tape_recording_t recording[TAPE_MAX_DEPTH];
+    u32 recording_count;
+} tape_exec_t;
+
+static inline u32
+tape_parts_count(tape_exec_t *exec)
+{
+    return exec->parts ? exec->parts->count : 0;
+}
+
+/* Copies a finished unit into the memo. */
+void
+tape_memo_store(tape_exec_t *exec, u32 op, u32 part_start)
+{
+    tape_t *tape = exec->tape;
+    tape_unit_t *unit = tape->units + op;
+    tape_memo_t *memo = exec->memo;
+
+    u32 base = tape->ops.data[op].slot;
+    mb_view_t view = exec->views[base];
+
+    if (tape->ops.data[op].kind == tape_Begin) {
+        view = mb_view_end(exec->mb, view);
+    }
+
+    pthread_mutex_lock(&memo->lock);
+
+    tape_memo_entry_t *entry = memo->entries + unit->first;
+
+    if (!entry->ready) {
+        mem_tag_t tag = mem_tag_set(mem_Cache);
+
+        mb_view_t copy = mb_view_copy(&memo->mb, exec->mb, view);
+
+        *entry = (tape_memo_entry_t) {
+            .ready        = true,
+            .vertex_start = copy.vertex_start,
+            .vertex_count = copy.vertex_count,
+            .slot_start   = memo->slots.count,
+            .part_start   = memo->parts.count,
+            .part_count   = tape_parts_count(exec) - part_start,
+        };
+
+        for (u32 s = base; s < unit->slot_end; ++s) {
+            mb_view_t relative = exec->views[s];
+            relative.vertex_start -= view.vertex_start;
+            dck_stretchy_push(memo->slots, relative);
+        }
+
+        for (u32 p = part_start; p < tape_parts_count(exec); ++p) {
+            mb_view_t relative = exec->parts->data[p];
+            relative.vertex_start -= view.vertex_start;
+            dck_stretchy_push(memo->parts, relative);
+        }
+
+        mem_tag_set(tag);
+    }
+
+    pthread_mutex_unlock(&memo->lock);
+}
+
+/* Copies the unit at `op` from the memo, if it's there yet. */
+b32
+tape_memo_load(tape_exec_t *exec, u32 op)
+{
+    tape_t *tape = exec->tape;
+    tape_unit_t *unit = tape->units + op;
+    tape_memo_t *memo = exec->memo;
+
+    pthread_mutex_lock(&memo->lock);
+
+    tape_memo_entry_t entry = memo->entries[unit->first];
+
+    if (!entry.ready) {
+        pthread_mutex_unlock(&memo->lock);
+        return false;
+    }
+
+    mb_view_t copy = mb_view_copy(exec->mb, &memo->mb, (mb_view_t) { entry.vertex_start, entry.vertex_count });
+
+    u32 base = tape->ops.data[op].slot;
+
+    for (u32 s = base; s < unit->slot_end; ++s) {
+        mb_view_t view = memo->slots.data[entry.slot_start + s - base];
+        view.vertex_start += copy.vertex_start;
+        exec->views[s] = view;
+    }
+
+    for (u32 p = 0; p < entry.part_count; ++p) {
+        mb_view_t part = memo->parts.data[entry.part_start + p];
+        part.vertex_start += copy.vertex_start;
+        mb_views_push(exec->parts, part);
+    }
+
+    memo->hits += 1;
+
+    pthread_mutex_unlock(&memo->lock);
+
+    return true;
+}
+
+/* Replays ops `begin` to `end`, both included. */
+void
+tape_exec_range(tape_exec_t *exec, u32 begin, u32 end)
+{
+    tape_t *tape = exec->tape;
+    mb_t *mb = exec->mb;
+
+    for (u32 i = begin; i <= end; ++i) {
+        tape_op_t *op = tape->ops.data + i;
+        tape_unit_t *unit = tape->units + i;
+
+        b32 is_unit  = op->kind == tape_Emit || op->kind == tape_Begin;
+        b32 repeated = is_unit && unit->first != TAPE_NO_UNIT;
+
+        if (repeated && i != unit->first && tape_memo_load(exec, i)) {
+            i = unit->end;
+            continue;
+        }
+
+        u32 part_start = tape_parts_count(exec);
+
+        if (op->kind == tape_Emit) {
+            mb_view_t view = exec->emit(mb, op->primitive, op->args);
+            exec->views[op->slot] = view;
+
+            if (op->flags & tape_Part) {
+                mb_views_push(exec->parts, view);
+            }
+
+            if (repeated) {
+                tape_memo_store(exec, i, part_start);
+            }
+        }
+        else if (op->kind == tape_Transform) {
+            mb_view_transform(mb, exec->views[op->slot], op->matrix);
+        }
+        else if (op->kind == tape_Dupe) {
+            mb_view_t src = exec->views[op->source];
+            mb_view_t dst = mb_view_dupe(mb, src, op->matrix);
+
+            exec->views[op->slot] = dst;
+            mb_views_dupe(exec->parts, src, dst);
+        }
+        else if (op->kind == tape_Begin) {
+            exec->views[op->slot] = mb_view_begin(mb);
+
+            if (repeated) {
+                exec->recording[exec->recording_count++] = (tape_recording_t) { i, part_start };
+            }
+        }
+        else if (op->kind == tape_End) {
+            u32 open = op->source;
+
+            if (exec->recording_count && exec->recording[exec->recording_count - 1].op == open) {
+                exec->recording_count -= 1;
+                tape_memo_store(exec, open, exec->recording[exec->recording_count].part_start);
+            }
+
+            exec->views[op->slot] = mb_view_end(mb, exec->views[op->slot]);
+        }
+    }
+}
+
+typedef struct
+{
+    jobs_done_t done;
+
+    tape_exec_t exec;
+
+    mb_t mb;
+    mb_views_t parts;
+
+    u32 op;
+    mem_tag_t tag; // of the thread that ran the tape
+} tape_branch_t;
+
+void
+tape_branch_run(void *arg)
+{
+    tape_branch_t *branch = arg;
+
+    mem_tag_t tag = mem_tag_set(branch->tag);
+    tape_exec_range(&branch->exec, branch->op, branch->exec.tape->units[branch->op].end);
+    mem_tag_set(tag);
+}
+
+/* Executes `tape` into `mb`, recording parts into `parts` when it's not NULL.
+ * `jobs` may be NULL to run everything on the calling thread. Returns the
+ * view of everything emitted, the view of each slot is left in `tape->views`.
+ */
+mb_view_t
+tape_run(tape_t *tape, mb_t *mb, mb_views_t *parts, tape_emit_t emit, jobs_t *jobs)
+{
+    if (!tape->units) {
+        tape_compile(tape);
+    }
+
+    u32 op_count = tape->ops.count;
+
+    mem_free(tape->views);
+
+    mb_view_t *views = mem_calloc(mem_tag(), tape->slot_count ? tape->slot_count : 1, sizeof(*views));
+    if (!views) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    tape_memo_t memo = {0};
+
+    pthread_mutex_init(&memo.lock, NULL);
+
+    memo.entries = mem_calloc(mem_tag(), op_count ? op_count : 1, sizeof(*memo.entries));
+    if (!memo.entries) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    tape_exec_t exec = {
+        .tape  = tape,
+        .emit  = emit,
+        .memo  = &memo,
+        .mb    = mb,
+        .parts = parts,
+        .views = views,
+    };
+
+    u32 branch_count = jobs ? tape->branches.count : 0;
+
+    tape_branch_t *branches = NULL;
+
+    if (branch_count) {
+        branches = mem_calloc(mem_tag(), branch_count, sizeof(*branches));
+        if (!branches) {
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+            exit(666);
+        }
+
+        for (u32 b = 0; b < branch_count; ++b) {
+            tape_branch_t *branch = branches + b;
+
+            branch->op   = tape->branches.data[b];
+            branch->exec = exec;
+            branch->tag  = mem_tag();
+
+            branch->exec.mb    = &branch->mb;
+            branch->exec.parts = parts ? &branch->parts : NULL;
+
+            jobs_push(jobs, tape_branch_run, branch, &branch->done);
+        }
+    }
+
+    mb_view_t full = mb_view_begin(mb);
+
+    u32 at = 0;
+
+    for (u32 b = 0; b <= branch_count; ++b) {
+        u32 stop = b < branch_count ? branches[b].op : op_count;
+
+        if (stop > at) {
+            tape_exec_range(&exec, at, stop - 1);
+        }
+
+        if (b == branch_count)
+            break;
+
+        // splice the branch in where it would have run
+        tape_branch_t *branch = branches + b;
+        tape_unit_t *unit = tape->units + branch->op;
+
+        jobs_wait(jobs, &branch->done);
+
+        mb_view_t whole = { 0, branch->mb.positions.count };
+        mb_view_t copy  = mb_view_copy(mb, &branch->mb, whole);
+
+        for (u32 s = tape->ops.data[branch->op].slot; s < unit->slot_end; ++s) {
+            views[s].vertex_start += copy.vertex_start;
+        }
+
+        dck_stretchy_for (branch->parts, mb_view_t, part) {
+            mb_views_push(parts, (mb_view_t) { part->vertex_start + copy.vertex_start, part->vertex_count });
+        }
+
+        mb_free(&branch->mb);
+        dck_stretchy_free(branch->parts);
+
+        at = unit->end + 1;
+    }
+
+    tape->views     = views;
+    tape->memo_hits = memo.hits;
+
+    mem_free(branches);
+
+    mb_free(&memo.mb);
+    dck_stretchy_free(memo.slots);
+    dck_stretchy_free(memo.parts);
+    mem_free(memo.entries);
+    pthread_mutex_destroy(&memo.lock);
+
+    return mb_view_end(mb, full);
+}
+
+#endif // TAPE_H_
@@ -0,0 +1,673 @@
+#ifndef TEX_CACHE_H_
+#define TEX_CACHE_H_
+
+/* Baked texture cache.
+ *
+ * The first time a texture is requested its source image is decoded, a full
+ * mip chain is generated and (optionally) every level is BC1 compressed. The
+ * result is stored in `CACHE_DIR` and on later runs mapped and handed to the
+ * driver as is, without touching the image decoder. Drivers without BC1
+ * support get compressed levels expanded back to RGBA8 at upload.
+ *
+ * An entry is reused while the source stamp (mtime + size) matches. When only
+ * the stamp differs the source is hashed, so a touched but unchanged file
+ * doesn't trigger a rebake.
+ */
+
+#include "core/utils.h"
+#include "core/io.h"
+
+#include "cache.h"
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include <string.h>
+
+#define TEX_CACHE_MAGIC     0x58455442 /* "BTEX" */
+#define TEX_CACHE_VERSION   1
+#define TEX_CACHE_EXT       ".btex"
+
+typedef enum
+{
+    tex_cache_None     = 0,
+    tex_cache_Compress = (1 << 0),
+} tex_cache_flags_t;
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+
+    cache_stamp_t stamp;
+    u64 source_hash;
+
+    u32 flags;
+
+    i32 width;
+    i32 height;
+    i32 format;
+    i32 mipmaps;
+
+    u32 padding;
+
+    u64 data_size;
+} tex_cache_header_t;
+
+/* A resolved texture waiting for upload. `data` points either into the mapped
+ * cache `entry` or at freshly `baked` levels.
+ */
+typedef struct
+{
+    tex_cache_header_t header;
+
+    io_map_t    entry;
+    u8         *baked;
+    const void *data;
+} tex_cache_pending_t;
+
+
+u32
+tex_cache_mip_count(i32 width, i32 height)
+{
+    u32 count = 1;
+
+    while (width > 1 || height > 1) {
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        ++count;
+    }
+
+    return count;
+}
+
+/* rlLoadTexture sizes compressed levels with its own formula, which only
+ * agrees with the real BC1 block size when every level is either a whole
+ * number of blocks or smaller than a block in both dimensions.
+ */
+b32
+tex_cache_bc1_compatible(i32 width, i32 height, u32 mipmaps)
+{
+    for (u32 i = 0; i < mipmaps; ++i) {
+        u64 real = (u64)((width + 3) / 4) * ((height + 3) / 4) * 8;
+        u64 rl   = (width < 4 && height < 4) ? 8 : (u64)width * height / 2;
+
+        if (real != rl)
+            return false;
+
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    return true;
+}
+
+/* Box filter, matches the floor halving rlLoadTexture expects. */
+void
+tex_cache_downsample(const u8 *src, i32 src_w, i32 src_h, u8 *dst, i32 dst_w, i32 dst_h)
+{
+    for (i32 y = 0; y < dst_h; ++y) {
+        i32 y0 = y * 2 < src_h ? y * 2 : src_h - 1;
+        i32 y1 = y * 2 + 1 < src_h ? y * 2 + 1 : y0;
+
+        for (i32 x = 0; x < dst_w; ++x) {
+            i32 x0 = x * 2 < src_w ? x * 2 : src_w - 1;
+            i32 x1 = x * 2 + 1 < src_w ? x * 2 + 1 : x0;
+
+            const u8 *p00 = src + (y0 * src_w + x0) * 4;
+            const u8 *p01 = src + (y0 * src_w + x1) * 4;
+            const u8 *p10 = src + (y1 * src_w + x0) * 4;
+            const u8 *p11 = src + (y1 * src_w + x1) * 4;
+
+            u8 *out = dst + (y * dst_w + x) * 4;
+
+            for (i32 c = 0; c < 4; ++c) {
+                out[c] = (u8)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+        }
+    }
+}
+
+static inline u16
+tex_cache_565(const u8 *rgb)
+{
+    return (u16)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+}
+
+static inline void
+tex_cache_565_expand(u16 c, i32 *rgb)
+{
+    rgb[0] = ((c >> 11) & 31) * 255 / 31;
+    rgb[1] = ((c >>  5) & 63) * 255 / 63;
+    rgb[2] = ( c        & 31) * 255 / 31;
+}
+
+/* Bounding box BC1 encoder, always in the opaque four color mode. */
+void
+tex_cache_bc1_block(const u8 block[16][4], u8 *out)
+{
+    u8 lo[3] = { 255, 255, 255 };
+    u8 hi[3] = { 0,   0,   0   };
+
+    for (i32 i = 0; i < 16; ++i) {
+        for (i32 c = 0; c < 3; ++c) {
+            if (block[i][c] < lo[c]) lo[c] = block[i][c];
+            if (block[i][c] > hi[c]) hi[c] = block[i][c];
+        }
+    }
+
+    // inset the box a bit so the endpoints don't land on outliers
+    for (i32 c = 0; c < 3; ++c) {
+        i32 inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+
+    // pick the box diagonal the colors actually lie along, using green
+    // (or red when green is flat) as the reference channel
+    i32 ref = hi[1] != lo[1] ? 1 : 0;
+
+    for (i32 c = 0; c < 3; ++c) {
+        if (c == ref)
+            continue;
+
+        i32 ref_mid = (lo[ref] + hi[ref]) / 2;
+        i32 mid     = (lo[c] + hi[c]) / 2;
+        i32 cov     = 0;
+
+        for (i32 i = 0; i < 16; ++i) {
+            cov += (block[i][ref] - ref_mid) * (block[i][c] - mid);
+        }
+
+        if (cov < 0) {
+            u8 t = lo[c]; lo[c] = hi[c]; hi[c] = t;
+        }
+    }
+
+    u16 c0 = tex_cache_565(hi);
+    u16 c1 = tex_cache_565(lo);
+
+    u32 indices = 0;
+
+    if (c0 < c1) {
+        u16 t = c0; c0 = c1; c1 = t;
+    }
+
+    if (c0 != c1) {
+        i32 palette[4][3];
+
+        tex_cache_565_expand(c0, palette[0]);
+        tex_cache_565_expand(c1, palette[1]);
+
+        for (i32 c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (i32 i = 0; i < 16; ++i) {
+            i32 best = 0;
+            i32 best_dist = 0x7fffffff;
+
+            for (i32 p = 0; p < 4; ++p) {
+                i32 dr = block[i][0] - palette[p][0];
+                i32 dg = block[i][1] - palette[p][1];
+                i32 db = block[i][2] - palette[p][2];
+
+                i32 dist = dr * dr + dg * dg + db * db;
+
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = p;
+                }
+            }
+
+            indices |= (u32)best << (i * 2);
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    out[4] = indices         & 0xff;
+    out[5] = (indices >> 8)  & 0xff;
+    out[6] = (indices >> 16) & 0xff;
+    out[7] = (indices >> 24) & 0xff;
+}
+
+/* Returns the number of bytes written into `out`. */
+size_t
+tex_cache_bc1_compress(const u8 *rgba, i32 width, i32 height, u8 *out)
+{
+    u8 *at = out;
+
+    for (i32 by = 0; by < height; by += 4) {
+        for (i32 bx = 0; bx < width; bx += 4) {
+            u8 block[16][4];
+
+            for (i32 y = 0; y < 4; ++y) {
+                i32 sy = by + y < height ? by + y : height - 1;
+
+                for (i32 x = 0; x < 4; ++x) {
+                    i32 sx = bx + x < width ? bx + x : width - 1;
+                    memcpy(block[y * 4 + x], rgba + (sy * width + sx) * 4, 4);
+                }
+            }
+
+            tex_cache_bc1_block((const u8 (*)[4])block, at);
+            at += 8;
+        }
+    }
+
+    return at - out;
+}
+
+/* Inverse of `tex_cache_bc1_compress`, writes `width` x `height` RGBA8 texels. */
+void
+tex_cache_bc1_decompress(const u8 *blocks, i32 width, i32 height, u8 *out)
+{
+    const u8 *at = blocks;
+
+    for (i32 by = 0; by < height; by += 4) {
+        for (i32 bx = 0; bx < width; bx += 4) {
+            u16 c0 = (u16)(at[0] | (at[1] << 8));
+            u16 c1 = (u16)(at[2] | (at[3] << 8));
+            u32 indices = (u32)at[4] | ((u32)at[5] << 8) | ((u32)at[6] << 16) | ((u32)at[7] << 24);
+
+            i32 palette[4][3];
+
+            tex_cache_565_expand(c0, palette[0]);
+            tex_cache_565_expand(c1, palette[1]);
+
+            for (i32 c = 0; c < 3; ++c) {
+                if (c0 > c1) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                else {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+
+            for (i32 y = 0; y < 4 && by + y < height; ++y) {
+                for (i32 x = 0; x < 4 && bx + x < width; ++x) {
+                    u32 p = (indices >> ((y * 4 + x) * 2)) & 3;
+                    u8 *texel = out + ((size_t)(by + y) * width + bx + x) * 4;
+
+                    texel[0] = (u8)palette[p][0];
+                    texel[1] = (u8)palette[p][1];
+                    texel[2] = (u8)palette[p][2];
+                    texel[3] = 255;
+                }
+            }
+
+            at += 8;
+        }
+    }
+}
+
+/* Builds the cache entry for `image` (RGBA8). Returns allocated level data. */
+u8 *
+tex_cache_bake(Image image, u32 flags, tex_cache_header_t *header)
+{
+    i32 width  = image.width;
+    i32 height = image.height;
+
+    u32 mipmaps = tex_cache_mip_count(width, height);
+
+    b32 compress = (flags & tex_cache_Compress)
+                && tex_cache_bc1_compatible(width, height, mipmaps);
+
+    size_t rgba_size = 0;
+    size_t bc1_size  = 0;
+
+    for (i32 i = 0, w = width, h = height; i < (i32)mipmaps; ++i) {
+        rgba_size += (size_t)w * h * 4;
+        bc1_size  += (size_t)((w + 3) / 4) * ((h + 3) / 4) * 8;
+
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    u8 *levels = mem_alloc(mem_Cache, rgba_size);
+    if (!levels) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    memcpy(levels, image.data, (size_t)width * height * 4);
+
+    u8 *src = levels;
+
+    for (i32 i = 1, w = width, h = height; i < (i32)mipmaps; ++i) {
+        i32 nw = w > 1 ? w / 2 : 1;
+        i32 nh = h > 1 ? h / 2 : 1;
+
+        u8 *dst = src + (size_t)w * h * 4;
+        tex_cache_downsample(src, w, h, dst, nw, nh);
+
+        src = dst;
+        w = nw;
+        h = nh;
+    }
+
+    size_t data_size = rgba_size;
+    i32 format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+    if (compress) {
+        u8 *blocks = mem_alloc(mem_Cache, bc1_size);
+        if (!blocks) {
+            fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+            exit(666);
+        }
+
+        u8 *level = levels;
+        u8 *at    = blocks;
+
+        for (i32 i = 0, w = width, h = height; i < (i32)mipmaps; ++i) {
+            at    += tex_cache_bc1_compress(level, w, h, at);
+            level += (size_t)w * h * 4;
+
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+
+        mem_free(levels);
+
+        levels    = blocks;
+        data_size = bc1_size;
+        format    = PIXELFORMAT_COMPRESSED_DXT1_RGB;
+    }
+    else if (flags & tex_cache_Compress) {
+        printf("Texture %dx%d can't be BC1 compressed, storing uncompressed.\n", width, height);
+    }
+
+    header->flags     = flags;
+    header->width     = width;
+    header->height    = height;
+    header->format    = format;
+    header->mipmaps   = mipmaps;
+    header->data_size = data_size;
+
+    return levels;
+}
+
+/* Bytes of a `mipmaps` level chain as rlLoadTexture reads it, 0 for a
+ * chain it can't be given (bad size, format or level count).
+ */
+u64
+tex_cache_data_size(i32 width, i32 height, i32 format, i32 mipmaps)
+{
+    if (width <= 0 || height <= 0 || mipmaps <= 0
+     || (u32)mipmaps > tex_cache_mip_count(width, height))
+        return 0;
+
+    b32 bc1 = format == PIXELFORMAT_COMPRESSED_DXT1_RGB;
+
+    if (!bc1 && format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+        return 0;
+
+    if (bc1 && !tex_cache_bc1_compatible(width, height, mipmaps))
+        return 0;
+
+    u64 size = 0;
+
+    for (i32 i = 0, w = width, h = height; i < mipmaps; ++i) {
+        size += bc1 ? (u64)((w + 3) / 4) * ((h + 3) / 4) * 8
+                    : (u64)w * h * 4;
+
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    return size;
+}
+
+/* Whether the driver takes BC1 levels. Asked once, by uploading a single
+ * block, rlgl refuses formats it has no extension for. GL thread only.
+ */
+b32
+tex_cache_bc1_supported(void)
+{
+    static i32 supported = -1;
+
+    if (supported < 0) {
+        u8 block[8] = {0};
+        u32 id = rlLoadTexture(block, 4, 4, PIXELFORMAT_COMPRESSED_DXT1_RGB, 1);
+
+        supported = id != 0;
+
+        if (id) {
+            rlUnloadTexture(id);
+        }
+        else {
+            printf("BC1 textures aren't supported, uploading them uncompressed.\n");
+        }
+    }
+
+    return supported;
+}
+
+/* Expands the BC1 levels of `header` into an allocated RGBA8 chain and turns
+ * `header` into its description.
+ */
+u8 *
+tex_cache_bc1_expand(tex_cache_header_t *header, const u8 *blocks)
+{
+    size_t rgba_size = (size_t)tex_cache_data_size(header->width, header->height,
+                                                   PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+                                                   header->mipmaps);
+
+    u8 *levels = mem_alloc(mem_Cache, rgba_size);
+    if (!levels) {
+        fprintf(stderr, "%s:%d: malloc failure! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    u8 *level = levels;
+
+    for (i32 i = 0, w = header->width, h = header->height; i < header->mipmaps; ++i) {
+        tex_cache_bc1_decompress(blocks, w, h, level);
+
+        blocks += (size_t)((w + 3) / 4) * ((h + 3) / 4) * 8;
+        level  += (size_t)w * h * 4;
+
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    header->format    = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    header->data_size = rgba_size;
+
+    return levels;
+}
+
+/* BC1 levels go up expanded to RGBA8 when the driver can't take them. */
+Texture2D
+tex_cache_upload(const tex_cache_header_t *header, const void *data)
+{
+    tex_cache_header_t upload = *header;
+    u8 *expanded = NULL;
+
+    if (upload.format == PIXELFORMAT_COMPRESSED_DXT1_RGB && !tex_cache_bc1_supported()) {
+        expanded = tex_cache_bc1_expand(&upload, data);
+        data     = expanded;
+    }
+
+    Texture2D texture = {
+        .width   = upload.width,
+        .height  = upload.height,
+        .mipmaps = upload.mipmaps,
+        .format  = upload.format,
+    };
+
+    texture.id = rlLoadTexture(data, upload.width, upload.height, upload.format, upload.mipmaps);
+
+    mem_free(expanded);
+
+    rlTextureParameters(texture.id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
+    rlTextureParameters(texture.id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_MIP_LINEAR);
+
+    return texture;
+}
+
+static inline b32
+tex_cache_header_valid(const tex_cache_header_t *header, size_t file_size, u32 flags)
+{
+    return file_size >= sizeof(*header)
+        && header->magic     == TEX_CACHE_MAGIC
+        && header->version   == TEX_CACHE_VERSION
+        && header->flags     == flags
+        && header->data_size == file_size - sizeof(*header)
+        && header->data_size == tex_cache_data_size(header->width, header->height,
+                                                    header->format, header->mipmaps);
+}
+
+/* Resolves `path` through the cache, baking it first if needed, without
+ * touching GL, so it can run on any thread. The data stays in `pending_o`
+ * until `tex_cache_finish` uploads it on the GL thread.
+ * Returns false only when the source image itself can't be loaded.
+ */
+b32
+tex_cache_prepare(const char *path, u32 flags, tex_cache_pending_t *pending_o)
+{
+    *pending_o = (tex_cache_pending_t) {0};
+
+    cache_stamp_t stamp;
+
+    if (!cache_stamp_get(path, &stamp))
+        return false;
+
+    char *entry_path = cache_path(path, TEX_CACHE_EXT);
+
+    io_map_t entry = {0};
+    b32 has_entry = io_map_file(entry_path, io_map_None, &entry);
+
+    tex_cache_header_t header = {0};
+
+    if (has_entry) {
+        if (io_map_size(entry) >= sizeof(header)) {
+            memcpy(&header, entry.begin, sizeof(header));
+        }
+
+        if (!tex_cache_header_valid(&header, io_map_size(entry), flags)) {
+            io_unmap_file(&entry);
+            has_entry = false;
+        }
+    }
+
+    if (has_entry && cache_stamp_eq(header.stamp, stamp)) {
+        *pending_o = (tex_cache_pending_t) {
+            .header = header,
+            .entry  = entry,
+            .data   = entry.begin + sizeof(header),
+        };
+
+        free(entry_path);
+        return true;
+    }
+
+    io_map_t source;
+
+    if (!io_map_file(path, io_map_Sequential, &source)) {
+        if (has_entry) {
+            io_unmap_file(&entry);
+        }
+
+        free(entry_path);
+        return false;
+    }
+
+    u64 source_hash = cache_hash(source.begin, io_map_size(source), CACHE_HASH_SEED);
+
+    if (has_entry && header.source_hash == source_hash) {
+        // only the header changes on disk, the mapped levels after it stay as they are
+        header.stamp = stamp;
+        cache_rewrite_header(entry_path, &header, sizeof(header));
+
+        *pending_o = (tex_cache_pending_t) {
+            .header = header,
+            .entry  = entry,
+            .data   = entry.begin + sizeof(header),
+        };
+
+        io_unmap_file(&source);
+        free(entry_path);
+
+        return true;
+    }
+
+    if (has_entry) {
+        io_unmap_file(&entry);
+    }
+
+    Image image = LoadImageFromMemory(GetFileExtension(path), (u8 *)source.begin,
+                                      (i32)io_map_size(source));
+    io_unmap_file(&source);
+
+    if (!IsImageReady(image)) {
+        free(entry_path);
+        return false;
+    }
+
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    header = (tex_cache_header_t) {
+        .magic       = TEX_CACHE_MAGIC,
+        .version     = TEX_CACHE_VERSION,
+        .stamp       = stamp,
+        .source_hash = source_hash,
+    };
+
+    u8 *levels = tex_cache_bake(image, flags, &header);
+    UnloadImage(image);
+
+    cache_write(entry_path, &header, sizeof(header), levels, header.data_size);
+    printf("Baked texture: %s -> %s\n", path, entry_path);
+
+    *pending_o = (tex_cache_pending_t) {
+        .header = header,
+        .data   = levels,
+        .baked  = levels,
+    };
+
+    free(entry_path);
+
+    return true;
+}
+
+/* Uploads what `tex_cache_prepare` produced and releases it. GL thread only. */
+Texture2D
+tex_cache_finish(tex_cache_pending_t *pending)
+{
+    Texture2D texture = tex_cache_upload(&pending->header, pending->data);
+
+    if (pending->entry.begin) {
+        io_unmap_file(&pending->entry);
+    }
+
+    mem_free(pending->baked);
+
+    *pending = (tex_cache_pending_t) {0};
+
+    return texture;
+}
+
+/* Loads `path` through the cache, baking it first if needed.
+ * Returns false only when the source image itself can't be loaded.
+ */
+b32
+tex_cache_load(const char *path, u32 flags, Texture2D *texture_o)
+{
+    tex_cache_pending_t pending;
+
+    if (!tex_cache_prepare(path, flags, &pending))
+        return false;
+
+    *texture_o = tex_cache_finish(&pending);
+
+    return true;
+}
+
+#endif // TEX_CACHE_H_